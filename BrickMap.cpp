@@ -0,0 +1,72 @@
+#include "BrickMap.h"
+#include "Math3d.h"
+
+BrickMap::BrickMap( void ) : m_volume(NULL), m_dim(0), m_bricksPerAxis(0) {}
+
+void BrickMap::Build(const Voxel *p_volume, int p_dim)
+{
+	m_volume = p_volume;
+	m_dim = p_dim;
+	m_bricksPerAxis = (p_dim + BrickSize - 1) / BrickSize;
+	m_occupied.Clear();
+
+	for (int bz = 0; bz < m_bricksPerAxis; ++bz) {
+		for (int by = 0; by < m_bricksPerAxis; ++by) {
+			for (int bx = 0; bx < m_bricksPerAxis; ++bx) {
+
+				Brick brick;
+				const int start[3] = { bx * BrickSize, by * BrickSize, bz * BrickSize };
+				const int end[3] = { Min2(start[0] + (int)BrickSize, p_dim), Min2(start[1] + (int)BrickSize, p_dim), Min2(start[2] + (int)BrickSize, p_dim) };
+				for (int i = 0; i < 3; ++i) {
+					brick.min[i] = end[i];
+					brick.max[i] = start[i];
+				}
+
+				for (int z = start[2]; z < end[2]; ++z) {
+					for (int y = start[1]; y < end[1]; ++y) {
+						const Voxel *voxel = p_volume + (voxel_index_t( z )*p_dim + y)*p_dim + start[0];
+						for (int x = start[0]; x < end[0]; ++x, ++voxel) {
+							if (!voxel->isEmpty) {
+								const int map[3] = { x, y, z };
+								for (int i = 0; i < 3; ++i) {
+									brick.min[i] = Min2(brick.min[i], map[i]);
+									brick.max[i] = Max2(brick.max[i], map[i] + 1);
+								}
+							}
+						}
+					}
+				}
+
+				if (brick.min[0] < brick.max[0]) {
+					m_occupied.PushBack(brick);
+				}
+			}
+		}
+	}
+}
+
+bool BrickMap::IsBuiltFor(const Voxel *p_volume, int p_dim) const
+{
+	return m_volume == p_volume && m_dim == p_dim;
+}
+
+void BrickMap::Invalidate( void )
+{
+	m_volume = NULL;
+	m_dim = 0;
+}
+
+int BrickMap::GetBricksPerAxis( void ) const
+{
+	return m_bricksPerAxis;
+}
+
+int BrickMap::GetOccupiedCount( void ) const
+{
+	return m_occupied.GetSize();
+}
+
+const BrickMap::Brick &BrickMap::GetOccupied(int p_index) const
+{
+	return m_occupied[p_index];
+}
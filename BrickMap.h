@@ -0,0 +1,36 @@
+#ifndef BRICKMAP_H_INCLUDED__
+#define BRICKMAP_H_INCLUDED__
+
+#include "mtlArray.h"
+#include "Voxel.h"
+
+// Coarse occupancy of a volume in BrickSize^3 blocks. Every occupied brick keeps
+// the tight bounds of its solid voxels.
+class BrickMap
+{
+public:
+	enum { BrickSize = 8 };
+	struct Brick
+	{
+		int	min[3];	// inclusive, in voxels
+		int	max[3];	// exclusive, in voxels
+	};
+private:
+	const Voxel				*m_volume;
+	int						m_dim;
+	int						m_bricksPerAxis;
+	mtl::Array<Brick>		m_occupied;
+private:
+				BrickMap(const BrickMap&) {}
+	BrickMap	&operator=(const BrickMap&) { return *this; }
+public:
+						BrickMap( void );
+	void				Build(const Voxel *p_volume, int p_dim);
+	bool				IsBuiltFor(const Voxel *p_volume, int p_dim) const;
+	void				Invalidate( void );
+	int					GetBricksPerAxis( void ) const;
+	int					GetOccupiedCount( void ) const;
+	const Brick			&GetOccupied(int p_index) const;
+};
+
+#endif
@@ -7,6 +7,10 @@ Camera::Camera(int windowWidth, int windowHeight)
 {
 	// Problem: does not depend on aspect ratio
 
+	// unturned port, right is +x and down is +y
+	m_port[PORT_UPPERLEFT] = vec3_t(-1.f, -1.f, 0.f);
+	m_port[PORT_UPPERRIGHT] = vec3_t(1.f, -1.f, 0.f);
+	m_port[PORT_LOWERLEFT] = vec3_t(-1.f, 1.f, 0.f);
 	SetPortVectors(windowWidth, windowHeight);
 
 	//
@@ -29,21 +33,14 @@ void Camera::SetPortVectors(int windowWidth, int windowHeight)
 {
 	// FOV is implemented by moving port away from origo
 	float ratio = float( windowHeight ) / float( windowWidth );
-	m_port[PORT_UPPERLEFT][0] = -1.f;
-	m_port[PORT_UPPERLEFT][1] = -ratio;
-	m_port[PORT_UPPERLEFT][2] = 0.f;
+	// laid out along the current right and down axes of the port, so that resizing keeps the camera turned
+	const vec3_t right = mml::Normalize(m_port[PORT_UPPERRIGHT] - m_port[PORT_UPPERLEFT]);
+	const vec3_t down = mml::Normalize(m_port[PORT_LOWERLEFT] - m_port[PORT_UPPERLEFT]);
 
-	m_port[PORT_UPPERRIGHT][0] = 1.f;
-	m_port[PORT_UPPERRIGHT][1] = -ratio;
-	m_port[PORT_UPPERRIGHT][2] = 0.f;
-
-	m_port[PORT_LOWERLEFT][0] = -1.f;
-	m_port[PORT_LOWERLEFT][1] = ratio;
-	m_port[PORT_LOWERLEFT][2] = 0.f;
-
-	m_port[PORT_LOWERRIGHT][0] = 1.f;
-	m_port[PORT_LOWERRIGHT][1] = ratio;
-	m_port[PORT_LOWERRIGHT][2] = 0.f;
+	m_port[PORT_UPPERLEFT] = -right - down * ratio;
+	m_port[PORT_UPPERRIGHT] = right - down * ratio;
+	m_port[PORT_LOWERLEFT] = -right + down * ratio;
+	m_port[PORT_LOWERRIGHT] = right + down * ratio;
 }
 
 const vec3_t &Camera::GetDirection( void ) const
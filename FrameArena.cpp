@@ -0,0 +1,150 @@
+#include <cstring>
+#include <new>
+
+#include "FrameArena.h"
+
+static size_t AlignUp(size_t p_value)
+{
+	return (p_value + FrameArena::Alignment - 1) & ~size_t( FrameArena::Alignment - 1 );
+}
+
+char *FrameArena::GetMemory(Block *p_block)
+{
+	return (char*)p_block + AlignUp(sizeof(Block));
+}
+
+void FrameArena::Poison(Block *p_block, size_t p_from)
+{
+#ifdef _DEBUG
+	if (p_block->used > p_from) {
+		memset(GetMemory(p_block) + p_from, PoisonByte, p_block->used - p_from);
+	}
+#else
+	(void)p_block;
+	(void)p_from;
+#endif
+}
+
+void FrameArena::PushBlock(size_t p_capacity)
+{
+	Block *block = (Block*)::operator new(AlignUp(sizeof(Block)) + p_capacity);
+	block->next = m_blocks;
+	block->capacity = p_capacity;
+	block->used = 0;
+	if (m_blocks != NULL) {
+		m_retired += m_blocks->used;
+	}
+	m_blocks = block;
+	++m_heapAllocations;
+}
+
+void FrameArena::FreeBlocks( void )
+{
+	while (m_blocks != NULL) {
+		Block *next = m_blocks->next;
+		::operator delete(m_blocks);
+		m_blocks = next;
+	}
+	m_retired = 0;
+}
+
+FrameArena::FrameArena( void ) : m_blocks(NULL), m_retired(0), m_highWater(0), m_heapAllocations(0) {}
+
+FrameArena::~FrameArena( void )
+{
+	CleanUp();
+}
+
+void *FrameArena::Allocate(size_t p_bytes)
+{
+	if (m_blocks != NULL) {
+		// blocks start aligned, so aligning the offset aligns the address
+		const size_t start = AlignUp(m_blocks->used);
+		if (start + p_bytes <= m_blocks->capacity) {
+			m_blocks->used = start + p_bytes;
+			const size_t used = m_retired + m_blocks->used;
+			if (used > m_highWater) { m_highWater = used; }
+			return GetMemory(m_blocks) + start;
+		}
+	}
+
+	size_t capacity = (m_blocks != NULL) ? m_blocks->capacity * 2 : (size_t)MinBlockBytes;
+	while (capacity < p_bytes) { capacity *= 2; }
+	PushBlock(capacity);
+	return Allocate(p_bytes);
+}
+
+FrameArena::Mark FrameArena::GetMark( void ) const
+{
+	Mark mark;
+	mark.block = m_blocks;
+	mark.used = (m_blocks != NULL) ? m_blocks->used : 0;
+	return mark;
+}
+
+void FrameArena::Rewind(const Mark &p_mark)
+{
+	if (m_blocks == NULL) { return; }
+	Block *mark = (Block*)p_mark.block;
+	if (m_blocks != mark) {
+		// blocks chained on since the mark are emptied; the newest one is kept for what comes next
+		// and the ones in between go back to the heap
+		Block *block = m_blocks->next;
+		while (block != mark) {
+			Block *next = block->next;
+			m_retired -= block->used;
+			::operator delete(block);
+			block = next;
+		}
+		Poison(m_blocks, 0);
+		m_blocks->used = 0;
+		m_blocks->next = mark;
+		if (mark == NULL) { return; }
+		m_retired -= mark->used - p_mark.used;
+	}
+	Poison(mark, p_mark.used);
+	mark->used = p_mark.used;
+}
+
+void FrameArena::Reset( void )
+{
+	if (m_blocks == NULL) { return; }
+	if (m_blocks->next != NULL) {
+		// the frame did not fit, replace the chain with one block that holds the largest frame so far
+		const size_t capacity = AlignUp(m_highWater + m_highWater / 4);
+		FreeBlocks();
+		PushBlock(capacity > (size_t)MinBlockBytes ? capacity : (size_t)MinBlockBytes);
+	} else {
+		Poison(m_blocks, 0);
+		m_blocks->used = 0;
+	}
+}
+
+void FrameArena::CleanUp( void )
+{
+	FreeBlocks();
+}
+
+size_t FrameArena::GetUsed( void ) const
+{
+	return (m_blocks != NULL) ? m_retired + m_blocks->used : 0;
+}
+
+size_t FrameArena::GetCapacity( void ) const
+{
+	size_t capacity = 0;
+	for (const Block *block = m_blocks; block != NULL; block = block->next) {
+		capacity += block->capacity;
+	}
+	return capacity;
+}
+
+size_t FrameArena::GetHighWater( void ) const
+{
+	return m_highWater;
+}
+
+int FrameArena::GetHeapAllocations( void ) const
+{
+	return m_heapAllocations;
+}
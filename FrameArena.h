@@ -0,0 +1,63 @@
+#ifndef FRAMEARENA_H_INCLUDED__
+#define FRAMEARENA_H_INCLUDED__
+
+#include <cstddef>
+
+// Linear allocator for data that only lives while a frame is rendered. Allocations
+// are bumped out of the newest block and never freed one by one; Reset releases
+// everything at once. When a frame needs more than the arena holds, another block is
+// chained on, and Reset merges the chain into one block of the high water size, so
+// after the first few frames rendering a frame does not touch the heap. Debug builds
+// fill released memory with PoisonByte so that data used past its frame stands out.
+// Not thread safe, every thread uses its own arena.
+class FrameArena
+{
+public:
+	enum { Alignment = 16 };
+	enum { MinBlockBytes = 64 * 1024 };
+	enum { PoisonByte = 0xcd };
+	struct Mark
+	{
+		void	*block;
+		size_t	used;
+	};
+private:
+	struct Block
+	{
+		Block	*next;		// older block
+		size_t	capacity;	// bytes after the header
+		size_t	used;
+	};
+private:
+	Block	*m_blocks;		// newest first, only the newest one is allocated from
+	size_t	m_retired;		// bytes used in the older blocks
+	size_t	m_highWater;
+	int		m_heapAllocations;
+private:
+				FrameArena(const FrameArena&) {}
+	FrameArena	&operator=(const FrameArena&) { return *this; }
+	static char	*GetMemory(Block *p_block);
+	static void	Poison(Block *p_block, size_t p_from);
+	void		PushBlock(size_t p_capacity);
+	void		FreeBlocks( void );
+public:
+				FrameArena( void );
+				~FrameArena( void );
+	// uninitialized, Alignment aligned memory that stays valid until Reset or a Rewind past it
+	void		*Allocate(size_t p_bytes);
+	template < typename type_t >
+	type_t		*Allocate(int p_count) { return (type_t*)Allocate(sizeof(type_t) * (size_t)p_count); }
+	// releases everything allocated since p_mark was taken
+	Mark		GetMark( void ) const;
+	void		Rewind(const Mark &p_mark);
+	// releases everything, call once per frame
+	void		Reset( void );
+	void		CleanUp( void );
+	size_t		GetUsed( void ) const;
+	size_t		GetCapacity( void ) const;
+	size_t		GetHighWater( void ) const;
+	// number of blocks taken from the heap so far
+	int			GetHeapAllocations( void ) const;
+};
+
+#endif
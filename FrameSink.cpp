@@ -0,0 +1,230 @@
+#include <cstring>
+
+#if defined __SSE2__ || defined _M_X64
+#include <emmintrin.h>
+#define FRAMESINK_SSE2
+#endif
+
+#include "FrameSink.h"
+
+void FillPixels(pixel_t *p_pixels, int p_count, pixel_t p_pixel)
+{
+	int i = 0;
+#ifdef FRAMESINK_SSE2
+	// single pixels up to a 16 byte boundary, then aligned stores of four
+	for (; i < p_count && ((size_t)(p_pixels + i) & 15) != 0; ++i) {
+		p_pixels[i] = p_pixel;
+	}
+	const __m128i four = _mm_set1_epi32(int( p_pixel ));
+	for (; i + 4 <= p_count; i += 4) {
+		_mm_store_si128((__m128i*)(p_pixels + i), four);
+	}
+#endif
+	for (; i < p_count; ++i) {
+		p_pixels[i] = p_pixel;
+	}
+}
+
+void UnpackPixels(const pixel_t *p_pixels, int p_count, byte_t *p_rgb)
+{
+	int i = 0;
+#ifdef FRAMESINK_SSE2
+	// 0x00RRGGBB is B, G, R, 0 in memory on x86: swap red and blue, then close the gaps of the unused bytes,
+	// first between the two pixels of each 64-bit half, then between the halves; 12 bytes out per 4 pixels
+	const __m128i byteMask = _mm_set1_epi32(0xff);
+	const __m128i greenMask = _mm_set1_epi32(0xff00);
+	const __m128i firstMask = _mm_set_epi32(0, 0xffffff, 0, 0xffffff);
+	const __m128i secondMask = _mm_set_epi32(0xffff, int( 0xff000000 ), 0xffff, int( 0xff000000 ));
+	for (; i + 4 <= p_count; i += 4) {
+		const __m128i pixels = _mm_loadu_si128((const __m128i*)(p_pixels + i));
+		const __m128i rgb = _mm_or_si128(
+			_mm_or_si128(_mm_and_si128(_mm_srli_epi32(pixels, 16), byteMask), _mm_and_si128(pixels, greenMask)),
+			_mm_slli_epi32(_mm_and_si128(pixels, byteMask), 16));
+		const __m128i halves = _mm_or_si128(_mm_and_si128(rgb, firstMask), _mm_and_si128(_mm_srli_epi64(rgb, 8), secondMask));
+		const __m128i packed = _mm_or_si128(_mm_move_epi64(halves), _mm_slli_si128(_mm_srli_si128(halves, 8), 6));
+		byte_t *dst = p_rgb + i * 3;
+		_mm_storel_epi64((__m128i*)dst, packed);
+		const int last = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+		memcpy(dst + 8, &last, 4);
+	}
+#endif
+	for (; i < p_count; ++i) {
+		p_rgb[i*3 + 0] = byte_t( GetRed(p_pixels[i]) );
+		p_rgb[i*3 + 1] = byte_t( GetGreen(p_pixels[i]) );
+		p_rgb[i*3 + 2] = byte_t( GetBlue(p_pixels[i]) );
+	}
+}
+
+BufferFrameSink::BufferFrameSink( void ) : m_width(0), m_height(0), m_frameCount(0) {}
+
+bool BufferFrameSink::Init(int p_width, int p_height)
+{
+	if (p_width <= 0 || p_height <= 0) { return false; }
+	m_pixels.Resize(p_width * p_height);
+	m_width = p_width;
+	m_height = p_height;
+	m_frameCount = 0;
+	return true;
+}
+
+void BufferFrameSink::CleanUp( void )
+{
+	m_pixels.Free();
+	m_width = m_height = 0;
+}
+
+int BufferFrameSink::GetWidth( void ) const
+{
+	return m_width;
+}
+
+int BufferFrameSink::GetHeight( void ) const
+{
+	return m_height;
+}
+
+pixel_t *BufferFrameSink::Lock( void )
+{
+	return m_pixels.GetData();
+}
+
+void BufferFrameSink::Unlock(const pixel_t*)
+{
+	++m_frameCount;
+}
+
+const pixel_t *BufferFrameSink::GetPixels( void ) const
+{
+	return m_pixels.GetData();
+}
+
+int BufferFrameSink::GetFrameCount( void ) const
+{
+	return m_frameCount;
+}
+
+SDLFrameSink::SDLFrameSink( void ) : m_width(0), m_height(0), m_direct(false) {}
+
+SDLFrameSink::~SDLFrameSink( void )
+{
+	CleanUp();
+}
+
+void SDLFrameSink::Convert(const pixel_t *p_pixels, SDL_Surface *p_surface) const
+{
+	const SDL_PixelFormat *format = p_surface->format;
+	const int bytes = format->BytesPerPixel;
+#ifdef FRAMESINK_SSE2
+	const __m128i byteMask = _mm_set1_epi32(0xff);
+	const __m128i loss[3] = { _mm_cvtsi32_si128(format->Rloss), _mm_cvtsi32_si128(format->Gloss), _mm_cvtsi32_si128(format->Bloss) };
+	const __m128i shift[3] = { _mm_cvtsi32_si128(format->Rshift), _mm_cvtsi32_si128(format->Gshift), _mm_cvtsi32_si128(format->Bshift) };
+#endif
+	for (int y = 0; y < m_height; ++y) {
+		const pixel_t *src = p_pixels + y * m_width;
+		Uint8 *dst = (Uint8*)p_surface->pixels + y * p_surface->pitch;
+		int x = 0;
+#ifdef FRAMESINK_SSE2
+		// four pixels at a time into 16 and 32-bit surfaces, 24-bit ones are left to the loop below
+		for (; bytes != 3 && x + 4 <= m_width; x += 4, dst += bytes * 4) {
+			const __m128i pixels = _mm_loadu_si128((const __m128i*)(src + x));
+			__m128i value = _mm_setzero_si128();
+			for (int c = 0; c < 3; ++c) {
+				const __m128i channel = _mm_and_si128(_mm_srli_epi32(pixels, 16 - c * 8), byteMask);
+				value = _mm_or_si128(value, _mm_sll_epi32(_mm_srl_epi32(channel, loss[c]), shift[c]));
+			}
+			if (bytes == 2) {
+				// the low halves, sign extended so that the saturating pack keeps them as they are
+				const __m128i low = _mm_srai_epi32(_mm_slli_epi32(value, 16), 16);
+				_mm_storel_epi64((__m128i*)dst, _mm_packs_epi32(low, low));
+			} else {
+				_mm_storeu_si128((__m128i*)dst, value);
+			}
+		}
+#endif
+		for (; x < m_width; ++x, dst += bytes) {
+			const Uint32 value =
+				((Uint32( GetRed(src[x]) ) >> format->Rloss) << format->Rshift) |
+				((Uint32( GetGreen(src[x]) ) >> format->Gloss) << format->Gshift) |
+				((Uint32( GetBlue(src[x]) ) >> format->Bloss) << format->Bshift);
+			switch (bytes) {
+			case 2:
+				*(Uint16*)dst = Uint16( value );
+				break;
+			case 3:
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+				dst[0] = Uint8( value );
+				dst[1] = Uint8( value >> 8 );
+				dst[2] = Uint8( value >> 16 );
+#else
+				dst[0] = Uint8( value >> 16 );
+				dst[1] = Uint8( value >> 8 );
+				dst[2] = Uint8( value );
+#endif
+				break;
+			default:
+				*(Uint32*)dst = value;
+				break;
+			}
+		}
+	}
+}
+
+bool SDLFrameSink::Init(int p_width, int p_height, bool p_fullscreen)
+{
+	CleanUp();
+	SDL_Surface *surface = SDL_SetVideoMode(p_width, p_height, 32, SDL_SWSURFACE|SDL_DOUBLEBUF|(p_fullscreen ? SDL_FULLSCREEN : SDL_RESIZABLE));
+	if (surface == NULL) { return false; }
+	if (surface->format->BytesPerPixel < 2) {
+		// palettized modes are not supported
+		SDL_FreeSurface(surface);
+		return false;
+	}
+	m_width = p_width;
+	m_height = p_height;
+	m_direct =
+		surface->format->BytesPerPixel == 4 &&
+		surface->format->Rmask == 0xff0000 && surface->format->Gmask == 0xff00 && surface->format->Bmask == 0xff &&
+		surface->pitch == p_width * 4;
+	return true;
+}
+
+void SDLFrameSink::CleanUp( void )
+{
+	if (m_width > 0 && SDL_GetVideoSurface() != NULL) {
+		SDL_FreeSurface(SDL_GetVideoSurface());
+	}
+	m_width = m_height = 0;
+	m_direct = false;
+}
+
+int SDLFrameSink::GetWidth( void ) const
+{
+	return m_width;
+}
+
+int SDLFrameSink::GetHeight( void ) const
+{
+	return m_height;
+}
+
+pixel_t *SDLFrameSink::Lock( void )
+{
+	SDL_Surface *surface = SDL_GetVideoSurface();
+	if (!m_direct || surface == NULL) { return NULL; }
+	if (SDL_MUSTLOCK(surface)) { SDL_LockSurface(surface); }
+	return (pixel_t*)surface->pixels;
+}
+
+void SDLFrameSink::Unlock(const pixel_t *p_pixels)
+{
+	SDL_Surface *surface = SDL_GetVideoSurface();
+	if (surface == NULL) { return; }
+	if (m_direct) {
+		if (SDL_MUSTLOCK(surface)) { SDL_UnlockSurface(surface); }
+	} else {
+		if (SDL_MUSTLOCK(surface)) { SDL_LockSurface(surface); }
+		Convert(p_pixels, surface);
+		if (SDL_MUSTLOCK(surface)) { SDL_UnlockSurface(surface); }
+	}
+	SDL_Flip(surface);
+}
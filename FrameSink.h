@@ -0,0 +1,82 @@
+#ifndef FRAMESINK_H_INCLUDED__
+#define FRAMESINK_H_INCLUDED__
+
+#include "PlatformSDL.h"
+#include "mtlArray.h"
+#include "Voxel.h"
+
+// 32-bit pixel, 0x00RRGGBB in a native endian word
+typedef Uint32 pixel_t;
+
+// packs channels given in color24 order (the order Voxel::rgb is stored in)
+inline pixel_t PackPixel(const int *rgb)
+{
+	return (pixel_t( rgb[color24::r] ) << 16) | (pixel_t( rgb[color24::g] ) << 8) | pixel_t( rgb[color24::b] );
+}
+
+inline int GetRed(pixel_t p_pixel)		{ return int( (p_pixel >> 16) & 0xff ); }
+inline int GetGreen(pixel_t p_pixel)	{ return int( (p_pixel >> 8) & 0xff ); }
+inline int GetBlue(pixel_t p_pixel)		{ return int( p_pixel & 0xff ); }
+
+// sets p_count pixels to p_pixel, four at a time with SSE2
+void FillPixels(pixel_t *p_pixels, int p_count, pixel_t p_pixel);
+// unpacks p_count pixels to 3 bytes each in R, G, B order, as image files store them; four at a time with SSE2
+void UnpackPixels(const pixel_t *p_pixels, int p_count, byte_t *p_rgb);
+
+// Destination of rendered frames. The renderer asks for memory to render the
+// next frame into, and hands the frame back when it is done. Sinks that can
+// store 32-bit pixels as they are give out their own memory so that nothing is
+// copied; the others return NULL and convert from the renderer's buffer instead.
+class FrameSink
+{
+public:
+	virtual					~FrameSink( void ) {}
+	virtual int				GetWidth( void ) const = 0;
+	virtual int				GetHeight( void ) const = 0;
+	// GetWidth() * GetHeight() pixels without padding, or NULL
+	virtual pixel_t			*Lock( void ) = 0;
+	// p_pixels is what Lock returned, or the renderer's own buffer when Lock returned NULL
+	virtual void			Unlock(const pixel_t *p_pixels) = 0;
+};
+
+// Keeps the last frame in memory.
+class BufferFrameSink : public FrameSink
+{
+private:
+	mtl::Array<pixel_t>	m_pixels;
+	int					m_width, m_height;
+	int					m_frameCount;
+public:
+					BufferFrameSink( void );
+	bool			Init(int p_width, int p_height);
+	void			CleanUp( void );
+	int				GetWidth( void ) const;
+	int				GetHeight( void ) const;
+	pixel_t			*Lock( void );
+	void			Unlock(const pixel_t *p_pixels);
+	const pixel_t	*GetPixels( void ) const;
+	int				GetFrameCount( void ) const;
+};
+
+// Presents frames in the SDL video surface. Renders straight into the surface
+// when it is 32-bit XRGB without padding, and converts otherwise. Windows are
+// resizable; call Init again with the size of an SDL_VIDEORESIZE event.
+class SDLFrameSink : public FrameSink
+{
+private:
+	int		m_width, m_height;
+	bool	m_direct;
+private:
+	void	Convert(const pixel_t *p_pixels, SDL_Surface *p_surface) const;
+public:
+			SDLFrameSink( void );
+			~SDLFrameSink( void );
+	bool	Init(int p_width, int p_height, bool p_fullscreen);
+	void	CleanUp( void );
+	int		GetWidth( void ) const;
+	int		GetHeight( void ) const;
+	pixel_t	*Lock( void );
+	void	Unlock(const pixel_t *p_pixels);
+};
+
+#endif
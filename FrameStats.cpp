@@ -0,0 +1,265 @@
+#include <cstring>
+#include <cstdlib>
+
+#ifdef __unix__
+#include <time.h>
+#define MONOTONIC_CLOCK_SUPPORTED
+#endif
+
+#include "FrameStats.h"
+#include "Math3d.h"
+
+enum { GlyphScale = 2 };	// pixels per font pixel
+enum { GlyphAdvance = 4 * GlyphScale };
+enum { LineHeight = 7 * GlyphScale };
+
+// 3x5 pixel glyphs, one octal digit per row from the top, the high bit on the left
+static int GetGlyph(char p_char)
+{
+	static const int digits[10] = { 075557, 026227, 071747, 071717, 055711, 074717, 074757, 071111, 075757, 075717 };
+	static const int letters[26] = {
+		025755, 065656, 034443, 065556, 074647, 074644, 034553, 055755, 072227, 011152, 055655, 044447, 057755,
+		065555, 025552, 065644, 025563, 065655, 034216, 072222, 055557, 055552, 055775, 055255, 055222, 071247
+	};
+	if (p_char >= '0' && p_char <= '9') { return digits[p_char - '0']; }
+	if (p_char >= 'A' && p_char <= 'Z') { return letters[p_char - 'A']; }
+	if (p_char >= 'a' && p_char <= 'z') { return letters[p_char - 'a']; }
+	switch (p_char) {
+	case '.': return 000002;
+	case ':': return 002020;
+	case '%': return 051245;
+	case '/': return 011244;
+	case '-': return 000700;
+	default: break;
+	}
+	return 0;
+}
+
+static int CompareFloats(const void *a, const void *b)
+{
+	const float fa = *(const float*)a;
+	const float fb = *(const float*)b;
+	return (fa < fb) ? -1 : ((fa > fb) ? 1 : 0);
+}
+
+void FrameStats::DrawText(pixel_t *p_pixels, int p_width, int p_height, int p_x, int p_y, const char *p_text)
+{
+	for (; *p_text != '\0'; ++p_text, p_x += GlyphAdvance) {
+		const int glyph = GetGlyph(*p_text);
+		for (int row = 0; row < 5 * GlyphScale; ++row) {
+			const int y = p_y + row;
+			if (y < 0 || y >= p_height) { continue; }
+			const int bits = (glyph >> (3 * (4 - row / GlyphScale))) & 7;
+			for (int column = 0; column < 3 * GlyphScale; ++column) {
+				const int x = p_x + column;
+				if (x >= 0 && x < p_width && (bits & (4 >> (column / GlyphScale))) != 0) {
+					p_pixels[y * p_width + x] = 0x00ffffff;
+				}
+			}
+		}
+	}
+}
+
+// a column per event, left empty where it was not counted
+void FrameStats::WriteEvents(FILE *p_file, const PerfCounters::Values *p_events)
+{
+	for (int i = 0; i < PerfCounters::EventCount; ++i) {
+		if (p_events != NULL && p_events->counts[i] >= 0) {
+			fprintf(p_file, ",%lld", p_events->counts[i]);
+		} else {
+			fprintf(p_file, ",");
+		}
+	}
+	fprintf(p_file, "\n");
+}
+
+FrameStats::FrameStats( void ) : m_count(0), m_next(0), m_frameNumber(0), m_hasCounters(false), m_csv(NULL), m_lastPrint(0.0), m_printMs(0.0)
+{
+	memset(&m_counters, 0, sizeof(m_counters));
+	m_counters.events.Clear();
+}
+
+FrameStats::~FrameStats( void )
+{
+	CleanUp();
+}
+
+double FrameStats::GetTimeMs( void )
+{
+#ifdef MONOTONIC_CLOCK_SUPPORTED
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000.0 + now.tv_nsec * 0.000001;
+#else
+	return (double)SDL_GetTicks();
+#endif
+}
+
+bool FrameStats::OpenCsv(const char *p_file)
+{
+	if (m_csv != NULL) { fclose(m_csv); }
+	m_csv = fopen(p_file, "w");
+	if (m_csv == NULL) {
+		std::cout << "Could not open " << p_file << " for writing" << std::endl;
+		return false;
+	}
+	fprintf(m_csv, "frame,ms,threads,rays,busiest_thread_rays,idlest_thread_rays,full_tiles,half_tiles,quarter_tiles");
+	for (int i = 0; i < PerfCounters::EventCount; ++i) {
+		fprintf(m_csv, ",%s", PerfCounters::GetName((PerfCounters::Event)i));
+	}
+	fprintf(m_csv, "\n");
+	return true;
+}
+
+void FrameStats::SetPrintInterval(float p_seconds)
+{
+	m_printMs = (p_seconds > 0.f) ? p_seconds * 1000.0 : 0.0;
+	m_lastPrint = GetTimeMs();
+}
+
+void FrameStats::CleanUp( void )
+{
+	if (m_csv != NULL) {
+		fclose(m_csv);
+		m_csv = NULL;
+	}
+}
+
+void FrameStats::AddFrame(float p_ms, const Renderer::FrameCounters *p_counters)
+{
+	m_times[m_next] = p_ms;
+	m_next = (m_next + 1) % WindowSize;
+	if (m_count < WindowSize) { ++m_count; }
+	m_hasCounters = p_counters != NULL;
+	m_threadEvents.Clear();
+	if (m_hasCounters) {
+		m_counters = *p_counters;
+		for (int i = 0; m_counters.threadEvents != NULL && i < m_counters.threads; ++i) {
+			m_threadEvents.PushBack(m_counters.threadEvents[i]);
+		}
+		m_counters.threadEvents = NULL;
+	}
+
+	if (m_csv != NULL) {
+		if (m_hasCounters) {
+			fprintf(m_csv, "%d,%.3f,%d,%d,%d,%d,%d,%d,%d", m_frameNumber, p_ms, m_counters.threads, m_counters.rays, m_counters.busiestThread, m_counters.idlestThread, m_counters.tiles[0], m_counters.tiles[1], m_counters.tiles[2]);
+			WriteEvents(m_csv, &m_counters.events);
+		} else {
+			fprintf(m_csv, "%d,%.3f,,,,,,,", m_frameNumber, p_ms);
+			WriteEvents(m_csv, NULL);
+		}
+	}
+	++m_frameNumber;
+
+	if (m_printMs > 0.0) {
+		const double now = GetTimeMs();
+		if (now - m_lastPrint >= m_printMs) {
+			m_lastPrint = now;
+			Print(std::cout);
+			if (m_csv != NULL) { fflush(m_csv); }
+		}
+	}
+}
+
+FrameStats::Summary FrameStats::GetSummary( void ) const
+{
+	Summary summary;
+	memset(&summary, 0, sizeof(summary));
+	summary.frames = m_count;
+	if (m_count == 0) { return summary; }
+
+	float sorted[WindowSize];
+	memcpy(sorted, m_times, sizeof(float) * m_count); // the window is the whole buffer once it is full
+	qsort(sorted, m_count, sizeof(float), CompareFloats);
+
+	double sum = 0.0;
+	for (int i = 0; i < m_count; ++i) {
+		sum += sorted[i];
+	}
+	summary.meanMs = float( sum / m_count );
+	// nearest rank percentiles
+	summary.p50Ms = sorted[(m_count * 50 + 99) / 100 - 1];
+	summary.p95Ms = sorted[(m_count * 95 + 99) / 100 - 1];
+	summary.p99Ms = sorted[(m_count * 99 + 99) / 100 - 1];
+
+	const int slowest = (m_count >= 100) ? m_count / 100 : 1;
+	double slowSum = 0.0;
+	for (int i = m_count - slowest; i < m_count; ++i) {
+		slowSum += sorted[i];
+	}
+	summary.lowFps = (slowSum > 0.0) ? float( 1000.0 * slowest / slowSum ) : 0.f;
+	return summary;
+}
+
+void FrameStats::Print(std::ostream &p_out) const
+{
+	const Summary summary = GetSummary();
+	char line[256];
+	sprintf(line, "last %d frames: mean %.2f ms (%.1f fps), p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, 1%% low %.1f fps",
+		summary.frames, summary.meanMs, (summary.meanMs > 0.f) ? 1000.f / summary.meanMs : 0.f, summary.p50Ms, summary.p95Ms, summary.p99Ms, summary.lowFps);
+	p_out << line << std::endl;
+	if (m_hasCounters) {
+		sprintf(line, "last frame: %d rays on %d threads (busiest %d, idlest %d), tiles %d full, %d half, %d quarter",
+			m_counters.rays, m_counters.threads, m_counters.busiestThread, m_counters.idlestThread, m_counters.tiles[0], m_counters.tiles[1], m_counters.tiles[2]);
+		p_out << line << std::endl;
+	}
+	if (m_hasCounters && m_counters.events.HasAny()) {
+		p_out << "last frame events: ";
+		m_counters.events.Print(p_out);
+		p_out << std::endl;
+		for (int i = 0; i < m_threadEvents.GetSize(); ++i) {
+			p_out << "  thread " << i << ": ";
+			m_threadEvents[i].Print(p_out);
+			p_out << std::endl;
+		}
+	}
+}
+
+void FrameStats::DrawOverlay(pixel_t *p_pixels, int p_width, int p_height) const
+{
+	if (p_pixels == NULL) { return; }
+
+	const Summary summary = GetSummary();
+	char lines[8][64];
+	int lineCount = 0;
+	sprintf(lines[lineCount++], "MEAN %.1f MS %.0f FPS", summary.meanMs, (summary.meanMs > 0.f) ? 1000.f / summary.meanMs : 0.f);
+	sprintf(lines[lineCount++], "P50 %.1f P95 %.1f P99 %.1f MS", summary.p50Ms, summary.p95Ms, summary.p99Ms);
+	sprintf(lines[lineCount++], "1%% LOW %.0f FPS", summary.lowFps);
+	if (m_hasCounters) {
+		sprintf(lines[lineCount++], "RAYS %d THREADS %d", m_counters.rays, m_counters.threads);
+		sprintf(lines[lineCount++], "THREAD RAYS %d-%d", m_counters.idlestThread, m_counters.busiestThread);
+		if (m_counters.tiles[0] + m_counters.tiles[1] + m_counters.tiles[2] > 0) {
+			sprintf(lines[lineCount++], "TILES %d/%d/%d", m_counters.tiles[0], m_counters.tiles[1], m_counters.tiles[2]);
+		}
+		const long long *events = m_counters.events.counts;
+		if (events[PerfCounters::EVENT_CYCLES] > 0 && events[PerfCounters::EVENT_INSTRUCTIONS] >= 0) {
+			sprintf(lines[lineCount++], "IPC %.2f", double( events[PerfCounters::EVENT_INSTRUCTIONS] ) / double( events[PerfCounters::EVENT_CYCLES] ));
+		}
+		if (events[PerfCounters::EVENT_LLC_MISSES] >= 0 && m_counters.rays > 0) {
+			sprintf(lines[lineCount++], "LLC MISSES/RAY %.2f", double( events[PerfCounters::EVENT_LLC_MISSES] ) / m_counters.rays);
+		}
+	}
+
+	// darken the box behind the text so that it reads on any image
+	int columns = 0;
+	for (int i = 0; i < lineCount; ++i) {
+		columns = Max2(columns, (int)strlen(lines[i]));
+	}
+	const int margin = GlyphScale * 2;
+	const int boxWidth = Min2(columns * GlyphAdvance + margin * 2, p_width);
+	const int boxHeight = Min2(lineCount * LineHeight + margin * 2, p_height);
+	for (int y = 0; y < boxHeight; ++y) {
+		pixel_t *pixel = p_pixels + y * p_width;
+		for (int x = 0; x < boxWidth; ++x) {
+			pixel[x] = (pixel[x] >> 2) & 0x003f3f3f;
+		}
+	}
+	for (int i = 0; i < lineCount; ++i) {
+		DrawText(p_pixels, p_width, p_height, margin, margin + i * LineHeight, lines[i]);
+	}
+}
+
+int FrameStats::GetFrameCount( void ) const
+{
+	return m_frameNumber;
+}
@@ -0,0 +1,63 @@
+#ifndef FRAMESTATS_H_INCLUDED__
+#define FRAMESTATS_H_INCLUDED__
+
+#include <cstdio>
+#include <iostream>
+
+#include "mtlArray.h"
+#include "FrameSink.h"
+#include "Renderer.h"
+
+// Frame times over a rolling window of the last WindowSize frames, with mean,
+// percentiles and 1% lows, so that stutter can be put into numbers. Can draw
+// them over a frame between Renderer::Render and Renderer::Refresh, print them
+// every so often, and log every frame to a CSV file. The renderer's counters
+// are included for frames that were rendered with instrumentation on, and
+// so are hardware event counts when the renderer was counting them.
+class FrameStats
+{
+public:
+	enum { WindowSize = 256 };	// frames
+	struct Summary
+	{
+		int		frames;			// in the window
+		float	meanMs;
+		float	p50Ms, p95Ms, p99Ms;
+		float	lowFps;			// 1% low, frame rate over the slowest 1% of the frames
+	};
+private:
+	float						m_times[WindowSize];	// ms, ring buffer
+	int							m_count;
+	int							m_next;
+	int							m_frameNumber;
+	Renderer::FrameCounters		m_counters;
+	bool						m_hasCounters;	// m_counters belong to the last frame
+	mtl::Array<PerfCounters::Values>	m_threadEvents;	// the last frame's, m_counters.threadEvents is not kept
+	FILE						*m_csv;
+	double						m_lastPrint;
+	double						m_printMs;		// 0 never prints
+private:
+					FrameStats(const FrameStats&) {}
+	FrameStats		&operator=(const FrameStats&) { return *this; }
+	static void		DrawText(pixel_t *p_pixels, int p_width, int p_height, int p_x, int p_y, const char *p_text);
+	static void		WriteEvents(FILE *p_file, const PerfCounters::Values *p_events);
+public:
+					FrameStats( void );
+					~FrameStats( void );
+	// milliseconds since an arbitrary point, finer than SDL_GetTicks where the platform allows
+	static double	GetTimeMs( void );
+	// writes a line per frame to p_file
+	bool			OpenCsv(const char *p_file);
+	// prints a summary every p_seconds from AddFrame (0 never does)
+	void			SetPrintInterval(float p_seconds);
+	void			CleanUp( void );
+	// p_counters is NULL when the frame was not rendered with instrumentation on
+	void			AddFrame(float p_ms, const Renderer::FrameCounters *p_counters);
+	Summary			GetSummary( void ) const;
+	void			Print(std::ostream &p_out) const;
+	// draws the statistics into the top left corner of a frame
+	void			DrawOverlay(pixel_t *p_pixels, int p_width, int p_height) const;
+	int				GetFrameCount( void ) const;
+};
+
+#endif
@@ -0,0 +1,223 @@
+#include <cstdio>
+#include <cstring>
+
+#include "FrameWriter.h"
+
+int FrameWriter::WorkerMain(void *p_writer)
+{
+	FrameWriter *writer = (FrameWriter*)p_writer;
+
+	SDL_mutexP(writer->m_lock);
+	while (true) {
+		while (writer->m_pendingCount == 0 && !writer->m_quit) {
+			SDL_CondWait(writer->m_notEmpty, writer->m_lock);
+		}
+		if (writer->m_pendingCount == 0) { break; } // quit, and nothing left to write
+
+		const int slot = writer->m_pending[writer->m_pendingHead];
+		writer->m_pendingHead = (writer->m_pendingHead + 1) % writer->m_slotCount;
+		--writer->m_pendingCount;
+		++writer->m_busyCount;
+		SDL_mutexV(writer->m_lock);
+
+		// encode and write without holding the lock
+		const bool success = writer->WriteFrame(writer->m_frames[slot]);
+
+		SDL_mutexP(writer->m_lock);
+		if (success)	{ ++writer->m_writtenCount; }
+		else			{ ++writer->m_errorCount; }
+		writer->m_free[writer->m_freeCount++] = slot;
+		--writer->m_busyCount;
+		SDL_CondSignal(writer->m_notFull);
+		if (writer->m_pendingCount == 0 && writer->m_busyCount == 0) {
+			SDL_CondBroadcast(writer->m_idle);
+		}
+	}
+	SDL_mutexV(writer->m_lock);
+	return 0;
+}
+
+bool FrameWriter::WriteFrame(const Frame &p_frame) const
+{
+	char fileName[sizeof(m_prefix) + 16];
+	sprintf(fileName, "%s%05d.ppm", m_prefix, p_frame.number);
+	FILE *file = fopen(fileName, "wb");
+	if (file == NULL) { return false; }
+
+	// binary PPM is plain RGB, so unpack the 32-bit pixels one scanline at a time
+	fprintf(file, "P6\n%d %d\n255\n", p_frame.width, p_frame.height);
+	byte_t *scanline = new byte_t[p_frame.width * 3];
+	bool success = true;
+	for (int y = 0; y < p_frame.height && success; ++y) {
+		UnpackPixels(p_frame.pixels + p_frame.width * y, p_frame.width, scanline);
+		success = (fwrite(scanline, 3, p_frame.width, file) == (size_t)p_frame.width);
+	}
+	delete [] scanline;
+	return (fclose(file) == 0) && success;
+}
+
+FrameWriter::FrameWriter( void ) :
+m_frames(NULL), m_free(NULL), m_pending(NULL),
+m_slotCount(0), m_width(0), m_height(0), m_locked(-1), m_nextNumber(0), m_freeCount(0), m_pendingHead(0), m_pendingCount(0), m_busyCount(0),
+m_errorCount(0), m_writtenCount(0), m_quit(false),
+m_threads(NULL), m_threadCount(0),
+m_lock(NULL), m_notFull(NULL), m_notEmpty(NULL), m_idle(NULL)
+{
+	m_prefix[0] = '\0';
+}
+
+FrameWriter::~FrameWriter( void )
+{
+	CleanUp();
+}
+
+bool FrameWriter::Init(const char *p_prefix, int p_width, int p_height, int p_threadCount, int p_slotCount)
+{
+	CleanUp();
+	if (p_width <= 0 || p_height <= 0 || p_threadCount <= 0 || p_slotCount <= 0 || strlen(p_prefix) >= sizeof(m_prefix)) {
+		return false;
+	}
+
+	strcpy(m_prefix, p_prefix);
+	m_slotCount = p_slotCount;
+	m_width = p_width;
+	m_height = p_height;
+	m_locked = -1;
+	m_nextNumber = 0;
+	m_frames = new Frame[m_slotCount];
+	m_free = new int[m_slotCount];
+	m_pending = new int[m_slotCount];
+	for (int i = 0; i < m_slotCount; ++i) {
+		m_frames[i].pixels = new pixel_t[p_width * p_height];
+		m_frames[i].width = p_width;
+		m_frames[i].height = p_height;
+		m_frames[i].number = 0;
+		m_free[i] = i;
+	}
+	m_freeCount = m_slotCount;
+	m_pendingHead = m_pendingCount = m_busyCount = 0;
+	m_errorCount = m_writtenCount = 0;
+	m_quit = false;
+
+	m_lock = SDL_CreateMutex();
+	m_notFull = SDL_CreateCond();
+	m_notEmpty = SDL_CreateCond();
+	m_idle = SDL_CreateCond();
+	m_threads = new SDL_Thread*[p_threadCount];
+	for (m_threadCount = 0; m_threadCount < p_threadCount; ++m_threadCount) {
+		m_threads[m_threadCount] = SDL_CreateThread(WorkerMain, this);
+		if (m_threads[m_threadCount] == NULL) { break; }
+	}
+	if (m_threadCount == 0) {
+		CleanUp();
+		return false;
+	}
+	return true;
+}
+
+void FrameWriter::CleanUp( void )
+{
+	if (m_lock != NULL) {
+		// let the workers drain the queue before they exit
+		SDL_mutexP(m_lock);
+		m_quit = true;
+		SDL_CondBroadcast(m_notEmpty);
+		SDL_mutexV(m_lock);
+		for (int i = 0; i < m_threadCount; ++i) {
+			SDL_WaitThread(m_threads[i], NULL);
+		}
+		SDL_DestroyCond(m_idle);
+		SDL_DestroyCond(m_notEmpty);
+		SDL_DestroyCond(m_notFull);
+		SDL_DestroyMutex(m_lock);
+	}
+	for (int i = 0; i < m_slotCount; ++i) {
+		delete [] m_frames[i].pixels;
+	}
+	delete [] m_frames;
+	delete [] m_free;
+	delete [] m_pending;
+	delete [] m_threads;
+	m_frames = NULL;
+	m_free = m_pending = NULL;
+	m_threads = NULL;
+	m_threadCount = 0;
+	m_slotCount = m_width = m_height = 0;
+	m_locked = -1;
+	m_freeCount = m_pendingHead = m_pendingCount = m_busyCount = 0;
+	m_lock = NULL;
+	m_notFull = m_notEmpty = m_idle = NULL;
+}
+
+int FrameWriter::GetWidth( void ) const
+{
+	return m_width;
+}
+
+int FrameWriter::GetHeight( void ) const
+{
+	return m_height;
+}
+
+pixel_t *FrameWriter::Lock( void )
+{
+	if (m_lock == NULL) { return NULL; }
+
+	if (m_locked < 0) {
+		SDL_mutexP(m_lock);
+		while (m_freeCount == 0) {
+			SDL_CondWait(m_notFull, m_lock); // backpressure, every slot is in flight
+		}
+		m_locked = m_free[--m_freeCount];
+		SDL_mutexV(m_lock);
+	}
+	return m_frames[m_locked].pixels;
+}
+
+void FrameWriter::Unlock(const pixel_t *p_pixels)
+{
+	if (m_lock == NULL) { return; }
+
+	if (m_locked < 0) { Lock(); }
+	const int slot = m_locked;
+	if (p_pixels != m_frames[slot].pixels) {
+		memcpy(m_frames[slot].pixels, p_pixels, sizeof(pixel_t) * m_width * m_height);
+	}
+	m_frames[slot].number = m_nextNumber++;
+	m_locked = -1;
+
+	SDL_mutexP(m_lock);
+	m_pending[(m_pendingHead + m_pendingCount) % m_slotCount] = slot;
+	++m_pendingCount;
+	SDL_CondSignal(m_notEmpty);
+	SDL_mutexV(m_lock);
+}
+
+void FrameWriter::Flush( void )
+{
+	if (m_lock == NULL) { return; }
+
+	SDL_mutexP(m_lock);
+	while (m_pendingCount > 0 || m_busyCount > 0) {
+		SDL_CondWait(m_idle, m_lock);
+	}
+	SDL_mutexV(m_lock);
+}
+
+int FrameWriter::GetErrorCount( void ) const
+{
+	if (m_lock == NULL) { return m_errorCount; }
+	SDL_mutexP(m_lock);
+	const int count = m_errorCount;
+	SDL_mutexV(m_lock);
+	return count;
+}
+
+int FrameWriter::GetWrittenCount( void ) const
+{
+	if (m_lock == NULL) { return m_writtenCount; }
+	SDL_mutexP(m_lock);
+	const int count = m_writtenCount;
+	SDL_mutexV(m_lock);
+	return count;
+}
@@ -0,0 +1,61 @@
+#ifndef FRAMEWRITER_H_INCLUDED__
+#define FRAMEWRITER_H_INCLUDED__
+
+#include "PlatformSDL.h"
+#include "FrameSink.h"
+
+// Writes numbered image files (<prefix>00000.ppm, <prefix>00001.ppm, ...)
+// on a pool of background threads. Frames are rendered straight into a fixed
+// number of preallocated slots, so the caller only blocks in Lock when every
+// slot is still waiting to be written (backpressure), never on the disk itself.
+class FrameWriter : public FrameSink
+{
+private:
+	struct Frame
+	{
+		pixel_t	*pixels;
+		int		width, height;
+		int		number;
+	};
+private:
+	char		m_prefix[256];
+	Frame		*m_frames;
+	int			*m_free;		// stack of slots that can be filled
+	int			*m_pending;		// fifo of slots that are waiting to be written
+	int			m_slotCount;
+	int			m_width, m_height;
+	int			m_locked;		// slot handed out by Lock, -1 when none
+	int			m_nextNumber;
+	int			m_freeCount;
+	int			m_pendingHead, m_pendingCount;
+	int			m_busyCount;	// slots currently being encoded by a worker
+	int			m_errorCount;
+	int			m_writtenCount;
+	bool		m_quit;
+	SDL_Thread	**m_threads;
+	int			m_threadCount;
+	SDL_mutex	*m_lock;
+	SDL_cond	*m_notFull;
+	SDL_cond	*m_notEmpty;
+	SDL_cond	*m_idle;
+private:
+				FrameWriter(const FrameWriter&) {}
+	FrameWriter	&operator=(const FrameWriter&) { return *this; }
+	static int	WorkerMain(void *p_writer);
+	bool		WriteFrame(const Frame &p_frame) const;
+public:
+				FrameWriter( void );
+				~FrameWriter( void );
+	bool		Init(const char *p_prefix, int p_width, int p_height, int p_threadCount, int p_slotCount);
+	void		CleanUp( void );
+	int			GetWidth( void ) const;
+	int			GetHeight( void ) const;
+	pixel_t		*Lock( void );
+	// queues the frame under the next number
+	void		Unlock(const pixel_t *p_pixels);
+	void		Flush( void );
+	int			GetErrorCount( void ) const;
+	int			GetWrittenCount( void ) const;
+};
+
+#endif
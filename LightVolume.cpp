@@ -0,0 +1,224 @@
+#include <iostream>
+
+#include "LightVolume.h"
+
+// GetNeighbours order, sky light travels down unweakened
+enum { SideDown = 3 };
+
+// the six face neighbours of a voxel in the order -x, +x, -y, +y, -z, +z, -1 where the volume ends
+static void GetNeighbours(int p_index, int p_dim, int *p_neighbours)
+{
+	const int x = p_index % p_dim;
+	const int y = (p_index / p_dim) % p_dim;
+	const int z = p_index / (p_dim * p_dim);
+	p_neighbours[0] = (x > 0)			? p_index - 1 : -1;
+	p_neighbours[1] = (x < p_dim - 1)	? p_index + 1 : -1;
+	p_neighbours[2] = (y > 0)			? p_index - p_dim : -1;
+	p_neighbours[3] = (y < p_dim - 1)	? p_index + p_dim : -1;
+	p_neighbours[4] = (z > 0)			? p_index - p_dim * p_dim : -1;
+	p_neighbours[5] = (z < p_dim - 1)	? p_index + p_dim * p_dim : -1;
+}
+
+int LightVolume::GetLevel(int p_index, Channel p_channel) const
+{
+	return (p_channel == CHANNEL_SKY) ? (m_levels[p_index] >> 4) : (m_levels[p_index] & 0x0f);
+}
+
+void LightVolume::SetLevel(int p_index, Channel p_channel, int p_level)
+{
+	if (p_channel == CHANNEL_SKY) {
+		m_levels[p_index] = byte_t( (m_levels[p_index] & 0x0f) | (p_level << 4) );
+	} else {
+		m_levels[p_index] = byte_t( (m_levels[p_index] & 0xf0) | p_level );
+	}
+}
+
+void LightVolume::Propagate(Channel p_channel)
+{
+	for (int head = 0; head < m_addQueue.GetSize(); ++head) {
+		const int index = m_addQueue[head];
+		const int level = GetLevel(index, p_channel);
+		int neighbours[6];
+		GetNeighbours(index, m_dim, neighbours);
+		for (int n = 0; n < 6; ++n) {
+			const int neighbour = neighbours[n];
+			if (neighbour < 0 || !m_volume[neighbour].isEmpty) { continue; }
+			const int next = (p_channel == CHANNEL_SKY && n == SideDown && level == MaxLevel) ? (int)MaxLevel : level - 1;
+			if (GetLevel(neighbour, p_channel) < next) {
+				SetLevel(neighbour, p_channel, next);
+				m_addQueue.PushBack(neighbour);
+			}
+		}
+	}
+	m_addQueue.Clear();
+}
+
+void LightVolume::Remove(Channel p_channel)
+{
+	for (int head = 0; head < m_removeQueue.GetSize(); ++head) {
+		const Removal removal = m_removeQueue[head];
+		int neighbours[6];
+		GetNeighbours(removal.index, m_dim, neighbours);
+		for (int n = 0; n < 6; ++n) {
+			const int neighbour = neighbours[n];
+			if (neighbour < 0) { continue; }
+			const int level = GetLevel(neighbour, p_channel);
+			if (level == 0) { continue; }
+			// darker neighbours (and sky light straight below) may have been lit through the removed voxel,
+			// brighter ones have a source of their own and flood the cleared region again
+			const bool lit = level < removal.level || (p_channel == CHANNEL_SKY && n == SideDown && removal.level == MaxLevel && level == MaxLevel);
+			if (lit) {
+				SetLevel(neighbour, p_channel, 0);
+				Removal next = { neighbour, level };
+				m_removeQueue.PushBack(next);
+				if (p_channel == CHANNEL_EMITTED && m_emission[neighbour] > 0) {
+					SetLevel(neighbour, p_channel, m_emission[neighbour]);
+					m_addQueue.PushBack(neighbour);
+				}
+			} else {
+				m_addQueue.PushBack(neighbour);
+			}
+		}
+	}
+	m_removeQueue.Clear();
+}
+
+void LightVolume::Clear(int p_index, Channel p_channel)
+{
+	const int level = GetLevel(p_index, p_channel);
+	if (level > 0) {
+		SetLevel(p_index, p_channel, 0);
+		Removal removal = { p_index, level };
+		m_removeQueue.PushBack(removal);
+	}
+}
+
+LightVolume::LightVolume( void ) : m_volume(NULL), m_dim(0), m_generation(0) {}
+
+bool LightVolume::Build(const Voxel *p_volume, int p_dim)
+{
+	if (p_dim > MaxDim) {
+		std::cout << "Volumes above " << MaxDim << "^3 are not lit" << std::endl;
+		CleanUp();
+		return false;
+	}
+	m_volume = p_volume;
+	m_dim = p_dim;
+	const int count = p_dim * p_dim * p_dim;
+	m_levels.Resize(count);
+	m_emission.Resize(count);
+	for (int i = 0; i < count; ++i) {
+		m_levels[i] = 0;
+		m_emission[i] = 0;
+	}
+
+	// sky light enters the top of every column
+	for (int z = 0; z < p_dim; ++z) {
+		for (int x = 0; x < p_dim; ++x) {
+			const int index = z * p_dim * p_dim + x;
+			if (p_volume[index].isEmpty) {
+				SetLevel(index, CHANNEL_SKY, MaxLevel);
+				m_addQueue.PushBack(index);
+			}
+		}
+	}
+	Propagate(CHANNEL_SKY);
+	++m_generation;
+	return true;
+}
+
+bool LightVolume::IsBuiltFor(const Voxel *p_volume, int p_dim) const
+{
+	return m_volume == p_volume && m_dim == p_dim && m_levels.GetSize() > 0;
+}
+
+void LightVolume::CleanUp( void )
+{
+	m_levels.Free();
+	m_emission.Free();
+	m_addQueue.Free();
+	m_removeQueue.Free();
+	m_volume = NULL;
+	m_dim = 0;
+	++m_generation;
+}
+
+void LightVolume::SetEmission(int p_x, int p_y, int p_z, int p_level)
+{
+	const int index = (p_z * m_dim + p_y) * m_dim + p_x;
+	const int level = (p_level < 0) ? 0 : ((p_level > MaxLevel) ? (int)MaxLevel : p_level);
+	m_emission[index] = byte_t( level );
+	if (level < GetLevel(index, CHANNEL_EMITTED)) {
+		Clear(index, CHANNEL_EMITTED);
+		Remove(CHANNEL_EMITTED);
+	}
+	if (level > GetLevel(index, CHANNEL_EMITTED)) {
+		SetLevel(index, CHANNEL_EMITTED, level);
+		m_addQueue.PushBack(index);
+	}
+	Propagate(CHANNEL_EMITTED);
+	++m_generation;
+}
+
+void LightVolume::UpdateVoxel(int p_x, int p_y, int p_z)
+{
+	const int index = (p_z * m_dim + p_y) * m_dim + p_x;
+	if (!m_volume[index].isEmpty) {
+		// solid now, the light that passed through the voxel is gone
+		Clear(index, CHANNEL_SKY);
+		Remove(CHANNEL_SKY);
+		Propagate(CHANNEL_SKY);
+		Clear(index, CHANNEL_EMITTED);
+		Remove(CHANNEL_EMITTED);
+		if (m_emission[index] > 0) {
+			SetLevel(index, CHANNEL_EMITTED, m_emission[index]);
+			m_addQueue.PushBack(index);
+		}
+		Propagate(CHANNEL_EMITTED);
+	} else {
+		// empty now, light flows in from the neighbours
+		int neighbours[6];
+		GetNeighbours(index, m_dim, neighbours);
+		const Channel channels[2] = { CHANNEL_SKY, CHANNEL_EMITTED };
+		for (int c = 0; c < 2; ++c) {
+			if (channels[c] == CHANNEL_SKY && p_y == 0) {
+				SetLevel(index, CHANNEL_SKY, MaxLevel);
+				m_addQueue.PushBack(index);
+			}
+			for (int n = 0; n < 6; ++n) {
+				if (neighbours[n] >= 0 && GetLevel(neighbours[n], channels[c]) > 0) {
+					m_addQueue.PushBack(neighbours[n]);
+				}
+			}
+			Propagate(channels[c]);
+		}
+	}
+	++m_generation;
+}
+
+int LightVolume::GetLevel(int p_index) const
+{
+	const int sky = m_levels[p_index] >> 4;
+	const int emitted = m_levels[p_index] & 0x0f;
+	return (sky > emitted) ? sky : emitted;
+}
+
+int LightVolume::GetSkyLevel(int p_index) const
+{
+	return GetLevel(p_index, CHANNEL_SKY);
+}
+
+int LightVolume::GetEmittedLevel(int p_index) const
+{
+	return GetLevel(p_index, CHANNEL_EMITTED);
+}
+
+int LightVolume::GetDim( void ) const
+{
+	return m_dim;
+}
+
+unsigned int LightVolume::GetGeneration( void ) const
+{
+	return m_generation;
+}
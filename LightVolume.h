@@ -0,0 +1,65 @@
+#ifndef LIGHTVOLUME_H_INCLUDED__
+#define LIGHTVOLUME_H_INCLUDED__
+
+#include "mtlArray.h"
+#include "Voxel.h"
+
+// Light levels (0 to MaxLevel) for every voxel of a volume, flood-filled from the
+// sky and from emitters the way block games light their worlds. Sky light enters
+// every empty column at y = 0 (the top of the screen for an unturned camera) and
+// travels down unweakened, everything else loses a level per voxel it crosses.
+// Solid voxels block light unless they emit it. Edits are applied incrementally:
+// light that a change removes is cleared by a breadth first pass outwards, and the
+// edge of the cleared region is flooded again from the light that is left.
+class LightVolume
+{
+public:
+	enum { MaxLevel = 15 };
+	enum { MaxDim = 1024 };	// levels are indexed with ints
+private:
+	struct Removal
+	{
+		int	index;
+		int	level;	// before it was cleared
+	};
+	enum Channel
+	{
+		CHANNEL_SKY,
+		CHANNEL_EMITTED
+	};
+private:
+	const Voxel				*m_volume;
+	int						m_dim;
+	mtl::Array<byte_t>		m_levels;	// sky level in the high nibble, emitted level in the low nibble
+	mtl::Array<byte_t>		m_emission;
+	mtl::Array<int>			m_addQueue;
+	mtl::Array<Removal>		m_removeQueue;
+	unsigned int			m_generation;
+private:
+					LightVolume(const LightVolume&) {}
+	LightVolume		&operator=(const LightVolume&) { return *this; }
+	int				GetLevel(int p_index, Channel p_channel) const;
+	void			SetLevel(int p_index, Channel p_channel, int p_level);
+	void			Propagate(Channel p_channel);
+	void			Remove(Channel p_channel);
+	void			Clear(int p_index, Channel p_channel);
+public:
+					LightVolume( void );
+	// lights p_volume by the sky alone, emitters are added with SetEmission; false for volumes above MaxDim
+	bool			Build(const Voxel *p_volume, int p_dim);
+	bool			IsBuiltFor(const Voxel *p_volume, int p_dim) const;
+	void			CleanUp( void );
+	// p_level 0 turns the emitter off, empty and solid voxels may both emit
+	void			SetEmission(int p_x, int p_y, int p_z, int p_level);
+	// call after the voxel at x,y,z of the volume was turned solid or empty
+	void			UpdateVoxel(int p_x, int p_y, int p_z);
+	// brightest of the sky and emitted light
+	int				GetLevel(int p_index) const;
+	int				GetSkyLevel(int p_index) const;
+	int				GetEmittedLevel(int p_index) const;
+	int				GetDim( void ) const;
+	// changes whenever a level changes
+	unsigned int	GetGeneration( void ) const;
+};
+
+#endif
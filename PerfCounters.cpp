@@ -0,0 +1,167 @@
+#include <cstring>
+#include <cstdio>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#define PERF_COUNTERS_SUPPORTED
+#endif
+
+#include "PerfCounters.h"
+
+#ifdef PERF_COUNTERS_SUPPORTED
+
+static int OpenEvent(unsigned int p_type, unsigned long long p_config)
+{
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = p_type;
+	attr.config = p_config;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	// this thread on any cpu
+	return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static unsigned long long GetCacheConfig(unsigned long long p_cache, unsigned long long p_result)
+{
+	return p_cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (p_result << 16);
+}
+
+#endif
+
+void PerfCounters::Values::Clear( void )
+{
+	for (int i = 0; i < EventCount; ++i) {
+		counts[i] = -1;
+	}
+}
+
+void PerfCounters::Values::Add(const Values &p_values)
+{
+	for (int i = 0; i < EventCount; ++i) {
+		if (p_values.counts[i] < 0) { continue; }
+		counts[i] = (counts[i] < 0) ? p_values.counts[i] : counts[i] + p_values.counts[i];
+	}
+}
+
+bool PerfCounters::Values::HasAny( void ) const
+{
+	for (int i = 0; i < EventCount; ++i) {
+		if (counts[i] >= 0) { return true; }
+	}
+	return false;
+}
+
+void PerfCounters::Values::Print(std::ostream &p_out) const
+{
+	const char *separator = "";
+	for (int i = 0; i < EventCount; ++i) {
+		if (counts[i] < 0) { continue; }
+		p_out << separator << GetName((Event)i) << " " << counts[i];
+		if (i == EVENT_INSTRUCTIONS && counts[EVENT_CYCLES] > 0) {
+			char ipc[32];
+			sprintf(ipc, " (%.2f per cycle)", double( counts[i] ) / double( counts[EVENT_CYCLES] ));
+			p_out << ipc;
+		}
+		separator = ", ";
+	}
+}
+
+PerfCounters::PerfCounters( void )
+{
+	for (int i = 0; i < EventCount; ++i) {
+		m_fds[i] = -1;
+		m_started[i] = false;
+	}
+}
+
+PerfCounters::~PerfCounters( void )
+{
+	Close();
+}
+
+bool PerfCounters::Open( void )
+{
+	Close();
+#ifdef PERF_COUNTERS_SUPPORTED
+	m_fds[EVENT_CYCLES] = OpenEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+	m_fds[EVENT_INSTRUCTIONS] = OpenEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+	m_fds[EVENT_L1D_MISSES] = OpenEvent(PERF_TYPE_HW_CACHE, GetCacheConfig(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_RESULT_MISS));
+	m_fds[EVENT_LLC_MISSES] = OpenEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+	m_fds[EVENT_BRANCH_MISSES] = OpenEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+	m_fds[EVENT_DTLB_MISSES] = OpenEvent(PERF_TYPE_HW_CACHE, GetCacheConfig(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_RESULT_MISS));
+	for (int i = 0; i < EventCount; ++i) {
+		if (m_fds[i] < 0) { m_fds[i] = -1; }
+	}
+#endif
+	Start();
+	return IsOpen();
+}
+
+void PerfCounters::Close( void )
+{
+	for (int i = 0; i < EventCount; ++i) {
+#ifdef PERF_COUNTERS_SUPPORTED
+		if (m_fds[i] >= 0) { close(m_fds[i]); }
+#endif
+		m_fds[i] = -1;
+	}
+}
+
+bool PerfCounters::IsOpen( void ) const
+{
+	for (int i = 0; i < EventCount; ++i) {
+		if (m_fds[i] >= 0) { return true; }
+	}
+	return false;
+}
+
+bool PerfCounters::Read(int p_event, Reading &p_reading) const
+{
+#ifdef PERF_COUNTERS_SUPPORTED
+	// read_format lays out the value, then the time enabled and the time running
+	unsigned long long data[3];
+	if (m_fds[p_event] < 0 || read(m_fds[p_event], data, sizeof(data)) != (ssize_t)sizeof(data)) { return false; }
+	p_reading.value = data[0];
+	p_reading.enabled = data[1];
+	p_reading.running = data[2];
+	return true;
+#else
+	(void)p_event;
+	(void)p_reading;
+	return false;
+#endif
+}
+
+void PerfCounters::Start( void )
+{
+	for (int i = 0; i < EventCount; ++i) {
+		m_started[i] = Read(i, m_start[i]);
+	}
+}
+
+void PerfCounters::Stop(Values &p_values) const
+{
+	for (int i = 0; i < EventCount; ++i) {
+		Reading now;
+		if (!m_started[i] || !Read(i, now)) {
+			p_values.counts[i] = -1;
+			continue;
+		}
+		// the counts are cumulative and never go back, a multiplexed event is scaled up over this interval only
+		const double value = double( now.value - m_start[i].value );
+		const double enabled = double( now.enabled - m_start[i].enabled );
+		const double running = double( now.running - m_start[i].running );
+		p_values.counts[i] = (running > 0.0) ? (long long)(value * enabled / running + 0.5) : 0;
+	}
+}
+
+const char *PerfCounters::GetName(Event p_event)
+{
+	static const char *names[EventCount] = { "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "dtlb_misses" };
+	return names[p_event];
+}
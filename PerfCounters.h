@@ -0,0 +1,67 @@
+#ifndef PERFCOUNTERS_H_INCLUDED__
+#define PERFCOUNTERS_H_INCLUDED__
+
+#include <iostream>
+
+// Hardware event counters of the calling thread, through Linux perf_event_open.
+// Events are opened one by one, so that a machine or virtual machine that lacks
+// some of them still counts the others; events the kernel has to share the
+// hardware counters for are scaled up by the time they were counted. Only user
+// space is counted, which unprivileged processes are allowed to do by default.
+// Elsewhere, or when perf events are off limits, nothing can be opened.
+class PerfCounters
+{
+public:
+	enum Event
+	{
+		EVENT_CYCLES,
+		EVENT_INSTRUCTIONS,
+		EVENT_L1D_MISSES,		// level 1 data cache read misses
+		EVENT_LLC_MISSES,		// last level cache misses
+		EVENT_BRANCH_MISSES,
+		EVENT_DTLB_MISSES,		// data TLB read misses
+		EventCount
+	};
+	struct Values
+	{
+		long long	counts[EventCount];	// -1 where an event was not counted
+
+		void		Clear( void );
+		// adds the events counted in p_values, so that sums over threads or frames only leave out what was never counted
+		void		Add(const Values &p_values);
+		bool		HasAny( void ) const;
+		// "cycles 123, instructions 456 (1.23 per cycle), ...", events that were not counted left out
+		void		Print(std::ostream &p_out) const;
+	};
+private:
+	// an event as read, before scaling
+	struct Reading
+	{
+		unsigned long long	value;
+		unsigned long long	enabled;	// ns the event was enabled
+		unsigned long long	running;	// ns it actually counted while sharing the hardware
+	};
+private:
+	int			m_fds[EventCount];	// -1 where the event could not be opened
+	Reading		m_start[EventCount];
+	bool		m_started[EventCount];	// m_start holds a reading
+private:
+				PerfCounters(const PerfCounters&) {}
+	PerfCounters	&operator=(const PerfCounters&) { return *this; }
+	bool		Read(int p_event, Reading &p_reading) const;
+public:
+				PerfCounters( void );
+				~PerfCounters( void );
+	// opens the events for the calling thread, false when none of them can be
+	bool		Open( void );
+	void		Close( void );
+	bool		IsOpen( void ) const;
+	// counts from here on, on the thread that opened the events
+	void		Start( void );
+	// events since Start, -1 for those not open
+	void		Stop(Values &p_values) const;
+	// as used for CSV columns, e.g. "llc_misses"
+	static const char	*GetName(Event p_event);
+};
+
+#endif
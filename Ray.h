@@ -1,6 +1,7 @@
 #ifndef RAY_H_INCLUDED__
 #define RAY_H_INCLUDED__
 
+#include <cfloat>
 #include "MathTypes.h"
 #include "Voxel.h"
 
@@ -8,13 +9,20 @@ struct Ray
 {
 	vec3_t	origin;
 	vec3_t	direction;
+	float	length;		// traversal gives up on voxels entered beyond this distance
+	float	start;		// cells the ray leaves before this distance are taken as empty and not sampled
+	voxel_index_t	resume;	// -1, or a voxel the ray hit before: traversal carries on from it without sampling it again
+
+	Ray( void ) : length(FLT_MAX), start(0.f), resume(-1) {}
 };
 
 struct CollisionInfo
 {
-	vec3_t	impact;		// absolute location of impact
-	int		side;		// what side of a voxel was hit (x=0, y=1, z=2)
-	Voxel	voxel;		// a copy of the voxel that was hit
+	vec3_t			impact;		// absolute location of impact
+	int				side;		// what side of a voxel was hit (x=0, y=1, z=2)
+	voxel_index_t	index;		// volume index of the voxel that was hit, -1 on a miss
+	float			distance;	// distance along the ray to where the hit voxel was entered, or where the ray left the volume
+	Voxel			voxel;		// a copy of the voxel that was hit
 };
 
 #endif
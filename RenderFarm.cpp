@@ -0,0 +1,729 @@
+#include <iostream>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#define RENDER_FARM_SUPPORTED
+#endif
+
+#include "RenderFarm.h"
+#include "VolumeFile.h"
+#include "Math3d.h"
+
+// Messages are a MessageHeader followed by 'bytes' bytes of payload, in the
+// byte order of the machines involved (the render floor is all one architecture).
+enum MessageType
+{
+	MSG_HELLO = 1,	// worker -> coordinator, HelloMessage
+	MSG_FRAME,		// coordinator -> worker, FrameMessage and the raw bytes of a Camera
+	MSG_TILE,		// coordinator -> worker, TileMessage
+	MSG_PIXELS,		// worker -> coordinator, TileMessage and the tile's pixels row by row
+	MSG_QUIT		// coordinator -> worker
+};
+
+enum { FarmMagic = 0x4d524146 }; // "FARM"
+enum { FarmVersion = 1 };
+enum { MaxMessageBytes = 64 << 20 };
+
+struct MessageHeader
+{
+	Uint32	type;
+	Uint32	bytes;
+};
+
+struct HelloMessage
+{
+	Uint32	magic;
+	Uint32	version;
+	Uint32	cameraBytes;	// workers have to be the same build as the coordinator
+	Uint32	voxelBytes;
+};
+
+struct FrameMessage
+{
+	Sint32	frame;
+	Sint32	width, height;
+	Sint32	traversal;
+	Sint32	splatting;
+};
+
+struct TileMessage
+{
+	Sint32	frame;
+	Sint32	tile;
+	Sint32	x0, y0, x1, y1;
+};
+
+#ifdef RENDER_FARM_SUPPORTED
+
+#ifdef MSG_NOSIGNAL
+static const int SendFlags = MSG_NOSIGNAL;
+#else
+static const int SendFlags = 0;
+#endif
+
+static bool SendAll(int p_socket, const void *p_data, size_t p_bytes)
+{
+	const char *data = (const char*)p_data;
+	while (p_bytes > 0) {
+		const ssize_t sent = send(p_socket, data, p_bytes, SendFlags);
+		if (sent < 0 && errno == EINTR) { continue; }
+		if (sent <= 0) { return false; }
+		data += sent;
+		p_bytes -= (size_t)sent;
+	}
+	return true;
+}
+
+static bool ReceiveAll(int p_socket, void *p_data, size_t p_bytes)
+{
+	char *data = (char*)p_data;
+	while (p_bytes > 0) {
+		const ssize_t received = recv(p_socket, data, p_bytes, 0);
+		if (received < 0 && errno == EINTR) { continue; }
+		if (received <= 0) { return false; }
+		data += received;
+		p_bytes -= (size_t)received;
+	}
+	return true;
+}
+
+static bool SendMessage(int p_socket, Uint32 p_type, const void *p_payload, size_t p_bytes, const void *p_extra = NULL, size_t p_extraBytes = 0)
+{
+	MessageHeader header;
+	header.type = p_type;
+	header.bytes = Uint32( p_bytes + p_extraBytes );
+	return
+		SendAll(p_socket, &header, sizeof(header)) &&
+		(p_bytes == 0 || SendAll(p_socket, p_payload, p_bytes)) &&
+		(p_extraBytes == 0 || SendAll(p_socket, p_extra, p_extraBytes));
+}
+
+// Listens on, or connects to, "unix:<path>" or "tcp:<host>:<port>". Returns the socket or -1.
+static int OpenSocket(const char *p_address, bool p_listen)
+{
+	if (strncmp(p_address, "unix:", 5) == 0) {
+		const char *path = p_address + 5;
+		sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if (strlen(path) >= sizeof(address.sun_path)) { return -1; }
+		strcpy(address.sun_path, path);
+
+		const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0) { return -1; }
+		bool success;
+		if (p_listen) {
+			unlink(path); // left behind by an earlier run
+			success = bind(fd, (const sockaddr*)&address, sizeof(address)) == 0 && listen(fd, 64) == 0;
+		} else {
+			success = connect(fd, (const sockaddr*)&address, sizeof(address)) == 0;
+		}
+		if (!success) {
+			close(fd);
+			return -1;
+		}
+		return fd;
+	}
+
+	if (strncmp(p_address, "tcp:", 4) == 0) {
+		const char *host = p_address + 4;
+		const char *port = strrchr(host, ':');
+		char hostName[256];
+		if (port == NULL || size_t(port - host) >= sizeof(hostName)) { return -1; }
+		memcpy(hostName, host, size_t(port - host));
+		hostName[port - host] = '\0';
+		++port;
+
+		addrinfo hints;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_flags = p_listen ? AI_PASSIVE : 0;
+		addrinfo *info = NULL;
+		if (getaddrinfo(hostName, port, &hints, &info) != 0) { return -1; }
+
+		int fd = -1;
+		for (addrinfo *i = info; i != NULL && fd < 0; i = i->ai_next) {
+			fd = socket(i->ai_family, i->ai_socktype, i->ai_protocol);
+			if (fd < 0) { continue; }
+			bool success;
+			if (p_listen) {
+				const int reuse = 1;
+				setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+				success = bind(fd, i->ai_addr, i->ai_addrlen) == 0 && listen(fd, 64) == 0;
+			} else {
+				success = connect(fd, i->ai_addr, i->ai_addrlen) == 0;
+			}
+			if (!success) {
+				close(fd);
+				fd = -1;
+			}
+		}
+		freeaddrinfo(info);
+		if (fd >= 0 && !p_listen) {
+			const int noDelay = 1; // tile requests are small and latency bound
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+		}
+		return fd;
+	}
+
+	return -1;
+}
+
+#endif
+
+RenderFarm::RenderFarm( void ) :
+m_listen(-1), m_width(0), m_height(0), m_volume(NULL), m_dim(0),
+m_localReady(false), m_frameNumber(0), m_camera(1, 1), m_tileMs(0.f), m_reassigned(0), m_localTiles(0)
+{
+	m_address[0] = '\0';
+	m_settings.traversal = Renderer::TRAVERSE_FLOAT;
+	m_settings.splatting = false;
+	m_settings.perfCounters = false;
+}
+
+RenderFarm::~RenderFarm( void )
+{
+	CleanUp();
+}
+
+bool RenderFarm::Init(const char *p_address, int p_width, int p_height, const Voxel *p_volume, int p_dim, const Settings &p_settings)
+{
+	CleanUp();
+#ifdef RENDER_FARM_SUPPORTED
+	if (p_width <= 0 || p_height <= 0 || strlen(p_address) >= sizeof(m_address)) { return false; }
+	signal(SIGPIPE, SIG_IGN); // workers that go away are noticed through failed sends
+	m_listen = OpenSocket(p_address, true);
+	if (m_listen < 0) {
+		std::cout << "Could not listen on " << p_address << std::endl;
+		return false;
+	}
+
+	strcpy(m_address, p_address);
+	m_width = p_width;
+	m_height = p_height;
+	m_volume = p_volume;
+	m_dim = p_dim;
+	m_settings = p_settings;
+	m_frame.Resize(p_width * p_height);
+	for (int y = 0; y < p_height; y += FarmTileSize) {
+		for (int x = 0; x < p_width; x += FarmTileSize) {
+			Tile tile;
+			tile.x0 = x;
+			tile.y0 = y;
+			tile.x1 = Min2(x + (int)FarmTileSize, p_width);
+			tile.y1 = Min2(y + (int)FarmTileSize, p_height);
+			tile.done = false;
+			tile.owners[0] = tile.owners[1] = -1;
+			tile.assignedAt = 0;
+			m_tiles.PushBack(tile);
+		}
+	}
+	m_frameNumber = 0;
+	m_tileMs = 0.f;
+	m_reassigned = m_localTiles = 0;
+	return true;
+#else
+	std::cout << "Render farm mode is not supported on this platform" << std::endl;
+	return false;
+#endif
+}
+
+int RenderFarm::SpawnLocalWorkers(int p_count, const char *p_volumeFile)
+{
+	int spawned = 0;
+#ifdef RENDER_FARM_SUPPORTED
+	for (int i = 0; i < p_count; ++i) {
+		const pid_t pid = fork();
+		if (pid == 0) {
+			close(m_listen);
+			for (int w = 0; w < m_workers.GetSize(); ++w) {
+				if (m_workers[w].socket >= 0) { close(m_workers[w].socket); }
+			}
+#ifdef __linux__
+			// a fresh process image, since only the forking thread survives fork and a loader or OpenMP
+			// threads of the coordinator may already be running
+			execl("/proc/self/exe", "VoxelRayTrace", "-worker", m_address, "-volume", p_volumeFile, "-perf", m_settings.perfCounters ? "1" : "0", (char*)NULL);
+#endif
+			_exit(RunWorker(m_address, p_volumeFile, m_settings.perfCounters));
+		}
+		if (pid > 0) {
+			m_children.PushBack((int)pid);
+			++spawned;
+		}
+	}
+#endif
+	return spawned;
+}
+
+int RenderFarm::WaitForWorkers(int p_count, Uint32 p_timeoutMs)
+{
+#ifdef RENDER_FARM_SUPPORTED
+	const Uint32 start = SDL_GetTicks();
+	int done = 0;
+	while (GetLiveCount() < p_count && SDL_GetTicks() - start < p_timeoutMs) {
+		pollfd fds[1];
+		fds[0].fd = m_listen;
+		fds[0].events = POLLIN;
+		if (poll(fds, 1, 10) > 0) { Accept(); }
+		for (int w = 0; w < m_workers.GetSize(); ++w) {
+			if (m_workers[w].socket >= 0 && !m_workers[w].ready) {
+				pollfd worker;
+				worker.fd = m_workers[w].socket;
+				worker.events = POLLIN;
+				if (poll(&worker, 1, 0) > 0) { Receive(w, NULL, done); }
+			}
+		}
+	}
+#endif
+	return GetLiveCount();
+}
+
+void RenderFarm::CleanUp( void )
+{
+#ifdef RENDER_FARM_SUPPORTED
+	for (int w = 0; w < m_workers.GetSize(); ++w) {
+		if (m_workers[w].socket >= 0) {
+			SendMessage(m_workers[w].socket, MSG_QUIT, NULL, 0);
+			close(m_workers[w].socket);
+		}
+	}
+	if (m_listen >= 0) {
+		close(m_listen);
+		if (strncmp(m_address, "unix:", 5) == 0) { unlink(m_address + 5); }
+	}
+	// children that hang are killed rather than waited on forever
+	const Uint32 start = SDL_GetTicks();
+	for (int i = 0; i < m_children.GetSize(); ++i) {
+		while (waitpid((pid_t)m_children[i], NULL, WNOHANG) == 0) {
+			if (SDL_GetTicks() - start > (Uint32)QuitGraceMs) {
+				kill((pid_t)m_children[i], SIGKILL);
+				waitpid((pid_t)m_children[i], NULL, 0);
+				break;
+			}
+			SDL_Delay(10);
+		}
+	}
+#endif
+	m_workers.Free();
+	m_children.Free();
+	m_tiles.Free();
+	m_frame.Free();
+	m_local.CleanUp();
+	m_localReady = false;
+	m_listen = -1;
+	m_address[0] = '\0';
+}
+
+void RenderFarm::Accept( void )
+{
+#ifdef RENDER_FARM_SUPPORTED
+	const int fd = accept(m_listen, NULL, NULL);
+	if (fd < 0) { return; }
+	const int noDelay = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay)); // fails harmlessly on UNIX sockets
+
+	Worker worker;
+	worker.socket = fd;
+	worker.ready = false;
+	worker.frame = -1;
+	worker.inFlight = 0;
+	worker.lastHeard = SDL_GetTicks();
+	m_workers.PushBack(worker);
+#endif
+}
+
+void RenderFarm::Receive(int p_worker, pixel_t *p_pixels, int &p_done)
+{
+#ifdef RENDER_FARM_SUPPORTED
+	Worker &worker = m_workers[p_worker];
+	const int ChunkBytes = 1 << 16;
+	const int size = worker.inbox.GetSize();
+	worker.inbox.Resize(size + ChunkBytes);
+	const ssize_t received = recv(worker.socket, worker.inbox.GetData() + size, ChunkBytes, 0);
+	if (received <= 0) {
+		worker.inbox.Resize(size);
+		if (received == 0 || (errno != EINTR && errno != EAGAIN)) { Drop(p_worker); }
+		return;
+	}
+	const int end = size + (int)received;
+	worker.inbox.Resize(end);
+	worker.lastHeard = SDL_GetTicks();
+
+	int offset = 0;
+	while (end - offset >= (int)sizeof(MessageHeader)) {
+		MessageHeader header;
+		memcpy(&header, worker.inbox.GetData() + offset, sizeof(header));
+		if (header.bytes > (Uint32)MaxMessageBytes) {
+			Drop(p_worker);
+			return;
+		}
+		if (end - offset - (int)sizeof(header) < (int)header.bytes) { break; } // the rest is still on its way
+		const byte_t *payload = worker.inbox.GetData() + offset + sizeof(header);
+
+		if (header.type == MSG_HELLO && header.bytes == sizeof(HelloMessage)) {
+			HelloMessage hello;
+			memcpy(&hello, payload, sizeof(hello));
+			if (hello.magic != FarmMagic || hello.version != FarmVersion || hello.cameraBytes != sizeof(Camera) || hello.voxelBytes != sizeof(Voxel)) {
+				std::cout << "Worker " << p_worker << " is an incompatible build" << std::endl;
+				Drop(p_worker);
+				return;
+			}
+			worker.ready = true;
+		} else if (header.type == MSG_PIXELS && header.bytes >= sizeof(TileMessage)) {
+			TileMessage message;
+			memcpy(&message, payload, sizeof(message));
+			--worker.inFlight;
+			if (message.frame == m_frameNumber && message.tile >= 0 && message.tile < m_tiles.GetSize()) {
+				Tile &tile = m_tiles[message.tile];
+				const int width = tile.x1 - tile.x0;
+				const int height = tile.y1 - tile.y0;
+				if (tile.owners[0] == p_worker) { tile.owners[0] = -1; }
+				if (tile.owners[1] == p_worker) { tile.owners[1] = -1; }
+				if (!tile.done && p_pixels != NULL && header.bytes == sizeof(message) + sizeof(pixel_t) * width * height) {
+					const byte_t *block = payload + sizeof(message);
+					for (int y = 0; y < height; ++y) {
+						memcpy(p_pixels + (tile.y0 + y) * m_width + tile.x0, block + sizeof(pixel_t) * width * y, sizeof(pixel_t) * width);
+					}
+					tile.done = true;
+					++p_done;
+					const float ms = float( SDL_GetTicks() - tile.assignedAt );
+					m_tileMs = (m_tileMs > 0.f) ? m_tileMs * 0.9f + ms * 0.1f : ms;
+				}
+			}
+		} else {
+			Drop(p_worker);
+			return;
+		}
+		offset += sizeof(header) + header.bytes;
+	}
+
+	if (offset > 0) {
+		memmove(worker.inbox.GetData(), worker.inbox.GetData() + offset, end - offset);
+		worker.inbox.Resize(end - offset);
+	}
+#endif
+}
+
+void RenderFarm::Drop(int p_worker)
+{
+#ifdef RENDER_FARM_SUPPORTED
+	Worker &worker = m_workers[p_worker];
+	if (worker.socket < 0) { return; }
+	close(worker.socket);
+	worker.socket = -1;
+	worker.ready = false;
+	worker.inFlight = 0;
+	worker.inbox.Free();
+	// its tiles go back to the queue unless another worker has them too
+	for (int t = 0; t < m_tiles.GetSize(); ++t) {
+		Tile &tile = m_tiles[t];
+		for (int o = 0; o < 2; ++o) {
+			if (tile.owners[o] == p_worker) {
+				tile.owners[o] = -1;
+				if (!tile.done) { ++m_reassigned; }
+			}
+		}
+	}
+	std::cout << "Worker " << p_worker << " dropped" << std::endl;
+#endif
+}
+
+bool RenderFarm::SendFrame(int p_worker)
+{
+#ifdef RENDER_FARM_SUPPORTED
+	FrameMessage message;
+	message.frame = m_frameNumber;
+	message.width = m_width;
+	message.height = m_height;
+	message.traversal = (Sint32)m_settings.traversal;
+	message.splatting = m_settings.splatting ? 1 : 0;
+	if (!SendMessage(m_workers[p_worker].socket, MSG_FRAME, &message, sizeof(message), &m_camera, sizeof(Camera))) {
+		return false;
+	}
+	m_workers[p_worker].frame = m_frameNumber;
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool RenderFarm::Assign(int p_worker, int p_tile)
+{
+#ifdef RENDER_FARM_SUPPORTED
+	Worker &worker = m_workers[p_worker];
+	Tile &tile = m_tiles[p_tile];
+	if (worker.frame != m_frameNumber && !SendFrame(p_worker)) {
+		Drop(p_worker);
+		return false;
+	}
+	TileMessage message;
+	message.frame = m_frameNumber;
+	message.tile = p_tile;
+	message.x0 = tile.x0;
+	message.y0 = tile.y0;
+	message.x1 = tile.x1;
+	message.y1 = tile.y1;
+	if (!SendMessage(worker.socket, MSG_TILE, &message, sizeof(message))) {
+		Drop(p_worker);
+		return false;
+	}
+	if (tile.owners[0] < 0 && tile.owners[1] < 0) {
+		tile.assignedAt = SDL_GetTicks();
+	} else {
+		++m_reassigned; // a second worker races the slow one
+	}
+	tile.owners[(tile.owners[0] < 0) ? 0 : 1] = p_worker;
+	if (worker.inFlight == 0) {
+		worker.lastHeard = SDL_GetTicks(); // silence is measured from the first tile it is waiting on
+	}
+	++worker.inFlight;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void RenderFarm::RenderLocally(int p_tile, pixel_t *p_pixels)
+{
+	if (!m_localReady) {
+		m_localReady = m_local.InitHeadless(m_width, m_height);
+		if (!m_localReady) { return; }
+		m_local.SetTraversal(m_settings.traversal);
+		m_local.SetSplatting(m_settings.splatting);
+	}
+	Tile &tile = m_tiles[p_tile];
+	m_local.RenderRegion(m_camera, m_volume, m_dim, tile.x0, tile.y0, tile.x1, tile.y1);
+	const pixel_t *pixels = m_local.GetPixels();
+	for (int y = tile.y0; y < tile.y1; ++y) {
+		memcpy(p_pixels + y * m_width + tile.x0, pixels + y * m_width + tile.x0, sizeof(pixel_t) * (tile.x1 - tile.x0));
+	}
+	tile.done = true;
+	++m_localTiles;
+}
+
+int RenderFarm::GetLiveCount( void ) const
+{
+	int count = 0;
+	for (int w = 0; w < m_workers.GetSize(); ++w) {
+		if (m_workers[w].socket >= 0 && m_workers[w].ready) { ++count; }
+	}
+	return count;
+}
+
+void RenderFarm::Render(const Camera &camera, FrameSink &sink)
+{
+	pixel_t *pixels = sink.Lock();
+	if (pixels == NULL) { pixels = m_frame.GetData(); }
+	m_camera = camera;
+	++m_frameNumber;
+	for (int t = 0; t < m_tiles.GetSize(); ++t) {
+		m_tiles[t].done = false;
+		m_tiles[t].owners[0] = m_tiles[t].owners[1] = -1;
+	}
+
+#ifdef RENDER_FARM_SUPPORTED
+	mtl::Array<pollfd> fds;
+	mtl::Array<int> polled;	// worker index of each entry in fds after the first
+	int done = 0;
+	while (done < m_tiles.GetSize()) {
+
+		// keep every worker busy; once the queue is empty, race tiles that take far longer than usual
+		const Uint32 now = SDL_GetTicks();
+		const Uint32 slowMs = Uint32( Max2(m_tileMs * 4.f, 100.f) );
+		for (int w = 0; w < m_workers.GetSize(); ++w) {
+			while (m_workers[w].socket >= 0 && m_workers[w].ready && m_workers[w].inFlight < MaxTilesInFlight) {
+				int next = -1;
+				for (int t = 0; t < m_tiles.GetSize() && next < 0; ++t) {
+					const Tile &tile = m_tiles[t];
+					if (!tile.done && tile.owners[0] < 0 && tile.owners[1] < 0) { next = t; }
+				}
+				for (int t = 0; t < m_tiles.GetSize() && next < 0; ++t) {
+					const Tile &tile = m_tiles[t];
+					const bool single = (tile.owners[0] < 0) != (tile.owners[1] < 0);
+					if (!tile.done && single && tile.owners[0] != w && tile.owners[1] != w && now - tile.assignedAt > slowMs) { next = t; }
+				}
+				if (next < 0 || !Assign(w, next)) { break; }
+			}
+		}
+
+		if (GetLiveCount() == 0) {
+			// nobody left to hand tiles to
+			for (int t = 0; t < m_tiles.GetSize(); ++t) {
+				if (!m_tiles[t].done) {
+					RenderLocally(t, pixels);
+					++done;
+				}
+			}
+			break;
+		}
+
+		// wait for results or new workers
+		fds.Clear();
+		polled.Clear();
+		pollfd listener;
+		listener.fd = m_listen;
+		listener.events = POLLIN;
+		listener.revents = 0;
+		fds.PushBack(listener);
+		for (int w = 0; w < m_workers.GetSize(); ++w) {
+			if (m_workers[w].socket >= 0) {
+				pollfd worker;
+				worker.fd = m_workers[w].socket;
+				worker.events = POLLIN;
+				worker.revents = 0;
+				fds.PushBack(worker);
+				polled.PushBack(w);
+			}
+		}
+		if (poll(fds.GetData(), fds.GetSize(), 20) > 0) {
+			for (int i = 1; i < fds.GetSize(); ++i) {
+				if (fds[i].revents != 0) { Receive(polled[i - 1], pixels, done); }
+			}
+			if (fds[0].revents & POLLIN) { Accept(); }
+		}
+
+		for (int w = 0; w < m_workers.GetSize(); ++w) {
+			if (m_workers[w].socket >= 0 && m_workers[w].inFlight > 0 && SDL_GetTicks() - m_workers[w].lastHeard > (Uint32)DeadWorkerMs) {
+				Drop(w);
+			}
+		}
+	}
+#else
+	for (int t = 0; t < m_tiles.GetSize(); ++t) {
+		RenderLocally(t, pixels);
+	}
+#endif
+
+	sink.Unlock(pixels);
+}
+
+int RenderFarm::GetWorkerCount( void ) const
+{
+	return GetLiveCount();
+}
+
+int RenderFarm::GetReassignedCount( void ) const
+{
+	return m_reassigned;
+}
+
+int RenderFarm::GetLocalTileCount( void ) const
+{
+	return m_localTiles;
+}
+
+int RenderFarm::RunWorker(const char *p_address, const char *p_volumeFile, bool p_perf)
+{
+#ifdef RENDER_FARM_SUPPORTED
+	signal(SIGPIPE, SIG_IGN);
+	MappedVolume volume;
+	if (!volume.Open(p_volumeFile)) { return 1; }
+
+	// the coordinator may still be starting up
+	int fd = -1;
+	for (int attempt = 0; attempt < 50 && fd < 0; ++attempt) {
+		fd = OpenSocket(p_address, false);
+		if (fd < 0) { SDL_Delay(100); }
+	}
+	if (fd < 0) {
+		std::cout << "Could not connect to " << p_address << std::endl;
+		return 1;
+	}
+	HelloMessage hello;
+	hello.magic = FarmMagic;
+	hello.version = FarmVersion;
+	hello.cameraBytes = sizeof(Camera);
+	hello.voxelBytes = sizeof(Voxel);
+	if (!SendMessage(fd, MSG_HELLO, &hello, sizeof(hello))) {
+		close(fd);
+		return 1;
+	}
+
+	Renderer renderer;
+	renderer.SetInstrumentation(p_perf);
+	if (p_perf && !renderer.SetPerfCounters(true)) {
+		std::cout << "Hardware performance counters are not available" << std::endl;
+	}
+	PerfCounters::Values events;
+	events.Clear();
+	mtl::Array<PerfCounters::Values> threadEvents;
+	int tiles = 0;
+	Camera camera(1, 1);
+	mtl::Array<byte_t> payload;
+	mtl::Array<pixel_t> block;
+	bool running = true;
+	while (running) {
+		MessageHeader header;
+		if (!ReceiveAll(fd, &header, sizeof(header)) || header.bytes > (Uint32)MaxMessageBytes) { break; }
+		payload.Resize((int)header.bytes);
+		if (header.bytes > 0 && !ReceiveAll(fd, payload.GetData(), header.bytes)) { break; }
+
+		if (header.type == MSG_FRAME && header.bytes == sizeof(FrameMessage) + sizeof(Camera)) {
+			FrameMessage message;
+			memcpy(&message, payload.GetData(), sizeof(message));
+			if (message.width != renderer.GetWidth() || message.height != renderer.GetHeight()) {
+				running = renderer.InitHeadless(message.width, message.height);
+			}
+			renderer.SetTraversal((Renderer::TraversalMode)message.traversal);
+			renderer.SetSplatting(message.splatting != 0);
+			memcpy((void*)&camera, payload.GetData() + sizeof(message), sizeof(Camera));
+		} else if (header.type == MSG_TILE && header.bytes == sizeof(TileMessage)) {
+			TileMessage message;
+			memcpy(&message, payload.GetData(), sizeof(message));
+			if (message.x0 < 0 || message.y0 < 0 || message.x1 > renderer.GetWidth() || message.y1 > renderer.GetHeight() || message.x0 >= message.x1 || message.y0 >= message.y1) {
+				break;
+			}
+			renderer.RenderRegion(camera, volume.GetVoxels(), volume.GetDim(), message.x0, message.y0, message.x1, message.y1);
+			const Renderer::FrameCounters &counters = renderer.GetCounters();
+			if (counters.threadEvents != NULL) {
+				events.Add(counters.events);
+				for (int i = 0; i < counters.threads; ++i) {
+					if (i == threadEvents.GetSize()) {
+						threadEvents.PushBack(counters.threadEvents[i]);
+					} else {
+						threadEvents[i].Add(counters.threadEvents[i]);
+					}
+				}
+			}
+			++tiles;
+			const int width = message.x1 - message.x0;
+			const int height = message.y1 - message.y0;
+			block.Resize(width * height);
+			const pixel_t *pixels = renderer.GetPixels();
+			for (int y = 0; y < height; ++y) {
+				memcpy(block.GetData() + width * y, pixels + (message.y0 + y) * renderer.GetWidth() + message.x0, sizeof(pixel_t) * width);
+			}
+			running = SendMessage(fd, MSG_PIXELS, &message, sizeof(message), block.GetData(), sizeof(pixel_t) * width * height);
+		} else {
+			running = false; // MSG_QUIT, or something this build does not understand
+		}
+	}
+	close(fd);
+	if (events.HasAny()) {
+		std::cout << "worker " << (int)getpid() << " traced " << tiles << " tiles: ";
+		events.Print(std::cout);
+		std::cout << std::endl;
+		for (int i = 0; i < threadEvents.GetSize(); ++i) {
+			std::cout << "  thread " << i << ": ";
+			threadEvents[i].Print(std::cout);
+			std::cout << std::endl;
+		}
+	}
+	return 0;
+#else
+	std::cout << "Render farm mode is not supported on this platform" << std::endl;
+	return 1;
+#endif
+}
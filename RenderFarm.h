@@ -0,0 +1,95 @@
+#ifndef RENDERFARM_H_INCLUDED__
+#define RENDERFARM_H_INCLUDED__
+
+#include "mtlArray.h"
+#include "Camera.h"
+#include "Renderer.h"
+#include "FrameSink.h"
+
+// Renders frames by handing out screen tiles to worker processes over UNIX
+// domain or TCP sockets. Addresses are "unix:<path>" or "tcp:<host>:<port>".
+// Workers map the same volume file, trace their tiles with Renderer and send
+// back the pixels. Tiles of workers that disconnect or stop responding go back
+// to the queue, tiles that take much longer than usual are handed to an idle
+// worker as well (whichever result arrives first is used), and the
+// coordinator traces whatever is left itself when no worker remains.
+// Workers may join at any time.
+class RenderFarm
+{
+public:
+	enum { FarmTileSize = 64 };
+	enum { MaxTilesInFlight = 2 };	// per worker, so that workers do not idle while results travel
+	enum { DeadWorkerMs = 10000 };	// a worker with tiles in flight that is silent for this long is dropped
+	enum { QuitGraceMs = 2000 };	// spawned workers still running this long after quitting are killed
+	struct Settings
+	{
+		Renderer::TraversalMode	traversal;
+		bool					splatting;
+		bool					perfCounters;	// workers count hardware events and print them when they quit
+	};
+private:
+	struct Worker
+	{
+		int					socket;		// -1 once the worker is gone
+		bool				ready;		// said hello
+		int					frame;		// last frame the worker was told about
+		int					inFlight;
+		Uint32				lastHeard;
+		mtl::Array<byte_t>	inbox;		// bytes of messages that are not complete yet
+	};
+	struct Tile
+	{
+		int		x0, y0, x1, y1;
+		bool	done;
+		int		owners[2];		// workers the tile is assigned to, -1 if none
+		Uint32	assignedAt;
+	};
+private:
+	char				m_address[256];
+	int					m_listen;
+	int					m_width, m_height;
+	const Voxel			*m_volume;
+	int					m_dim;
+	Settings			m_settings;
+	mtl::Array<Worker>	m_workers;
+	mtl::Array<Tile>	m_tiles;
+	mtl::Array<int>		m_children;		// process ids of spawned local workers
+	mtl::Array<pixel_t>	m_frame;		// composed into when the sink has no memory to give
+	Renderer			m_local;		// traces tiles when no worker is left
+	bool				m_localReady;
+	int					m_frameNumber;
+	Camera				m_camera;
+	float				m_tileMs;		// running average of tile round trips
+	int					m_reassigned;
+	int					m_localTiles;
+private:
+				RenderFarm(const RenderFarm&) : m_camera(1, 1) {}
+	RenderFarm	&operator=(const RenderFarm&) { return *this; }
+	void		Accept( void );
+	void		Receive(int p_worker, pixel_t *p_pixels, int &p_done);
+	void		Drop(int p_worker);
+	bool		Assign(int p_worker, int p_tile);
+	bool		SendFrame(int p_worker);
+	void		RenderLocally(int p_tile, pixel_t *p_pixels);
+	int			GetLiveCount( void ) const;
+public:
+				RenderFarm( void );
+				~RenderFarm( void );
+	// listens on p_address for workers
+	bool		Init(const char *p_address, int p_width, int p_height, const Voxel *p_volume, int p_dim, const Settings &p_settings);
+	// forks p_count worker processes on this machine that map p_volumeFile (on Linux they run this executable again)
+	int			SpawnLocalWorkers(int p_count, const char *p_volumeFile);
+	// waits until p_count workers have connected, or p_timeoutMs passed
+	int			WaitForWorkers(int p_count, Uint32 p_timeoutMs);
+	void		CleanUp( void );
+	void		Render(const Camera &camera, FrameSink &sink);
+	int			GetWorkerCount( void ) const;
+	int			GetReassignedCount( void ) const;
+	int			GetLocalTileCount( void ) const;
+
+	// worker side, returns once the coordinator quits or goes away; with p_perf prints the hardware events
+	// counted over the tiles it traced before it returns
+	static int	RunWorker(const char *p_address, const char *p_volumeFile, bool p_perf);
+};
+
+#endif
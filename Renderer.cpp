@@ -1,144 +1,2393 @@
-//#include <omp.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <cstring>
+#include <cstdlib>
+#include <cfloat>
+#include <cstdio>
+#include <cmath>
 
 #include "PlatformSDL.h"
 #include "Ray.h"
 #include "Renderer.h"
 #include "Math3d.h"
+#include "VolumeMemory.h"
+#include "ThreadTopology.h"
+
+static const float SplatMargin = 0.05f; // voxels, brick bounds are grown by this much before splatting
+static const float GIBounceOffset = 0.001f; // voxels, bounce rays start this far off the face they leave
+static const float GISkyRadiance = 1.f;
+static const float GIConvergedError = 1.f / 255.f; // standard error of a pixel's mean luminance at which it counts as converged
+static const float TranslucentCutoff = 1.f / 64.f; // transmittance at which a ray counts as blocked
+static const int DeadlineRays = 4; // time budgeted frames look at the clock once per this many rays, a power of two
+
+static int GetThreadCount( void )
+{
+#ifdef _OPENMP
+	return omp_get_max_threads();
+#else
+	return 1;
+#endif
+}
+
+static int GetThreadIndex( void )
+{
+#ifdef _OPENMP
+	return omp_get_thread_num();
+#else
+	return 0;
+#endif
+}
+
+static int GetTeamSize( void )
+{
+#ifdef _OPENMP
+	return omp_get_num_threads();
+#else
+	return 1;
+#endif
+}
+
+static double GetTimeMs( void )
+{
+#ifdef _OPENMP
+	return omp_get_wtime() * 1000.0;
+#else
+	return double( SDL_GetTicks() );
+#endif
+}
+
+// Hash based random numbers, so that a pixel's samples do not depend on which thread traces them.
+static inline Uint32 HashUint(Uint32 x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x;
+}
+
+static inline float NextRandom(Uint32 &state)
+{
+	state = HashUint(state + 0x9e3779b9u);
+	return float( state >> 8 ) * (1.f / 16777216.f); // [0,1)
+}
+
+static int Gcd(int a, int b)
+{
+	while (b != 0) {
+		const int t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+// Point p_index of a Z-order curve over a square of power of two side: the bits of x and y interleaved.
+static void GetMortonPoint(int p_index, int &x, int &y)
+{
+	x = y = 0;
+	for (int bit = 0; p_index >> (2 * bit) != 0; ++bit) {
+		x |= ((p_index >> (2 * bit)) & 1) << bit;
+		y |= ((p_index >> (2 * bit + 1)) & 1) << bit;
+	}
+}
+
+// Point p_index of a Hilbert curve over a square of power of two side p_side, built up from the smallest
+// quadrants, each of which is turned so that the curve enters it next to where it left the one before.
+static void GetHilbertPoint(int p_side, int p_index, int &x, int &y)
+{
+	x = y = 0;
+	for (int size = 1; size < p_side; size *= 2) {
+		const int rx = 1 & (p_index / 2);
+		const int ry = 1 & (p_index ^ rx);
+		if (ry == 0) {
+			if (rx == 1) {
+				x = size - 1 - x;
+				y = size - 1 - y;
+			}
+			const int t = x;
+			x = y;
+			y = t;
+		}
+		x += size * rx;
+		y += size * ry;
+		p_index /= 4;
+	}
+}
+
+// Returns the index into the selected KernelTable (m_kernels) for a ray direction (bit set = negative component).
+static inline int GetOctant(const vec3_t &direction)
+{
+	return (direction[0] < 0.f ? 1 : 0) | (direction[1] < 0.f ? 2 : 0) | (direction[2] < 0.f ? 4 : 0);
+}
+
+// a + b, and the rounding error of that sum exactly (Knuth's two-sum, needs doubles that are not held in
+// wider registers)
+static void TwoSum(double a, double b, double &p_sum, double &p_error)
+{
+	p_sum = a + b;
+	const double bPart = p_sum - a;
+	p_error = (a - (p_sum - bPart)) + (b - bPart);
+}
+
+// sign of the exact sum of p_terms: they are grown into an expansion of non-overlapping doubles of increasing
+// magnitude (Shewchuk), and the largest component that is not zero has the sign of the sum
+static int GetExactSign(const double *p_terms, int p_count)
+{
+	double expansion[4];
+	for (int t = 0; t < p_count; ++t) {
+		double sum = p_terms[t];
+		for (int i = 0; i < t; ++i) {
+			TwoSum(sum, expansion[i], sum, expansion[i]);
+		}
+		expansion[t] = sum;
+	}
+	for (int i = p_count - 1; i >= 0; --i) {
+		if (expansion[i] != 0.0) { return (expansion[i] > 0.0) ? 1 : -1; }
+	}
+	return 0;
+}
+
+// sign of t_a - t_b, the distances at which the ray leaves cell map on axes a and b, worked out exactly.
+// The distances are offset * length / |direction|, so that is the sign of offset_a * |direction_b| -
+// offset_b * |direction_a|; every offset is the difference of a float and an integer, and all four products
+// are exact in double. An axis the ray runs parallel to is never left.
+static int CompareExitDistances(const Ray &ray, const int *map, int a, int b)
+{
+	const double dirA = fabs(double( ray.direction[a] ));
+	const double dirB = fabs(double( ray.direction[b] ));
+	if (dirA == 0.0 || dirB == 0.0) { return (dirA == dirB) ? 0 : ((dirA == 0.0) ? 1 : -1); }
+	const double highA = (ray.direction[a] < 0.f) ? double( ray.origin[a] ) : map[a] + 1.0;
+	const double lowA = (ray.direction[a] < 0.f) ? double( map[a] ) : double( ray.origin[a] );
+	const double highB = (ray.direction[b] < 0.f) ? double( ray.origin[b] ) : map[b] + 1.0;
+	const double lowB = (ray.direction[b] < 0.f) ? double( map[b] ) : double( ray.origin[b] );
+	const double terms[4] = { highA * dirB, -lowA * dirB, -highB * dirA, lowB * dirA };
+	return GetExactSign(terms, 4);
+}
+
+// the axis through which the ray leaves cell map, decided exactly, ties going to the lower axis like in the
+// traversals
+static int GetExactExitSide(const Ray &ray, const int *map)
+{
+	int side = 0;
+	if (CompareExitDistances(ray, map, 1, side) < 0) { side = 1; }
+	if (CompareExitDistances(ray, map, 2, side) < 0) { side = 2; }
+	return side;
+}
+
+// log2 of a power of two volume dimension, used for shift based indexing
+template < int n >
+struct Log2
+{
+	enum { Value = Log2<n/2>::Value + 1 };
+};
+
+template <>
+struct Log2<1>
+{
+	enum { Value = 0 };
+};
+
+// Index of a voxel, shift based when the volume dimension is a compile time power of two.
+template < int Dim >
+static inline voxel_index_t GetVoxelIndex(const int *map, const int dim)
+{
+	if (Dim > 0) {
+		const int shift = Log2<(Dim > 0) ? Dim : 1>::Value;
+		return (voxel_index_t( map[2] ) << (shift * 2)) | (voxel_index_t( map[1] ) << shift) | map[0];
+	}
+	return (voxel_index_t( map[2] ) * dim + map[1]) * dim + map[0];
+}
 
-CollisionInfo Renderer::GetIntersection(Ray ray, const Voxel *volume, const int dim) const
+// DDA specialized on the ray's octant so that step directions, index strides and
+// bounds tests are compile time constants. Produces the same result as the generic
+// traversal for any ray whose direction lies in the octant. Dim is the volume
+// dimension when it is known at compile time, or 0 for any dimension.
+template < int octant, int Dim >
+CollisionInfo Renderer::GetIntersection(const Ray &ray, const Voxel *volume, const int p_dim)
 {
+	const int dim = (Dim > 0) ? Dim : p_dim;
+	const int sx = (octant & 1) ? -1 : 1;
+	const int sy = (octant & 2) ? -1 : 1;
+	const int sz = (octant & 4) ? -1 : 1;
+
 	CollisionInfo collisionInfo;
+	collisionInfo.index = -1;
 	collisionInfo.voxel.isEmpty = true;
 
-	// calculate distances to axis boundries and direction of discrete DDA steps
+	// calculate distances to axis boundries
 	int map[3] = { int( ray.origin[0] ), int( ray.origin[1] ), int( ray.origin[2] ) };
+	const int step[3] = { sx, sy, sz };
 	vec3_t deltaDist;
-	int step[3];
 	for (int i = 0; i < 3; ++i) {
 		const float x = (ray.direction[0] / ray.direction[i]);
 		const float y = (ray.direction[1] / ray.direction[i]);
 		const float z = (ray.direction[2] / ray.direction[i]);
 		deltaDist[i] = sqrt( x*x + y*y + z*z );
-		if (ray.direction[i] < 0.f) {
-			step[i] = -1;
+		if (step[i] < 0) {
 			collisionInfo.impact[i] = (ray.origin[i] - map[i]) * deltaDist[i];
 		} else {
-			step[i] = 1;
 			collisionInfo.impact[i] = (map[i] + 1.f - ray.origin[i]) * deltaDist[i];
 		}
 	}
 
-	// perform DDA
+	// a side distance past limit means the cell it leads into is entered beyond ray.length
+	const float limit[3] = { ray.length + deltaDist[0], ray.length + deltaDist[1], ray.length + deltaDist[2] };
+
+	// a resumed ray starts out in the cell it hit, every axis adding up its side distance as often as the
+	// traversal did to get there; otherwise cells left before ray.start are stepped over the same way without
+	// sampling them, so either way it carries on exactly as if it had stepped there itself
+	if (ray.resume >= 0) {
+		const int cell[3] = { int( ray.resume % dim ), int( ray.resume / dim % dim ), int( ray.resume / dim / dim ) };
+		for (int i = 0; i < 3; ++i) {
+			for (int n = (cell[i] - map[i]) * step[i]; n > 0; --n) {
+				collisionInfo.impact[i] += deltaDist[i];
+			}
+			map[i] = cell[i];
+		}
+	} else if (ray.start > 0.f) {
+		bool inside = true;
+		for (int i = 0; i < 3 && inside; ++i) {
+			while (collisionInfo.impact[i] < ray.start && inside) {
+				collisionInfo.impact[i] += deltaDist[i];
+				map[i] += step[i];
+				inside = (unsigned int)map[i] < (unsigned int)dim && collisionInfo.impact[i] <= limit[i];
+			}
+		}
+		if (!inside || !volume[GetVoxelIndex<Dim>(map, dim)].isEmpty) {
+			// the ray left the volume, or reached a solid cell, before ray.start; only a full trace knows where
+			Ray full = ray;
+			full.start = 0.f;
+			return GetIntersection<octant, Dim>(full, volume, p_dim);
+		}
+	}
+
+	// perform DDA, stepping the volume index along with the map coordinates
+	const voxel_index_t strideY = sy * dim;
+	const voxel_index_t strideZ = sz * voxel_index_t( dim ) * dim;
+	voxel_index_t index = GetVoxelIndex<Dim>(map, dim);
+	float *impact = collisionInfo.impact;
 	while (true) {
 
-		// determine what side dimension should be incremented
-		collisionInfo.side = 0;
-		for (int i = 1; i < 3; ++i) {
-			if (collisionInfo.impact[collisionInfo.side] > collisionInfo.impact[i]) {
-				collisionInfo.side = i;
+		// determine what side dimension should be incremented (ties resolve towards the lower axis)
+		if (impact[0] > impact[1]) {
+			if (impact[1] > impact[2]) {
+				collisionInfo.side = 2;
+				impact[2] += deltaDist[2];
+				map[2] += sz;
+				if (sz < 0 ? map[2] < 0 : map[2] >= dim) { break; } // out of bounds
+				if (impact[2] > limit[2]) { break; } // beyond the end of the ray
+				index += strideZ;
+			} else {
+				collisionInfo.side = 1;
+				impact[1] += deltaDist[1];
+				map[1] += sy;
+				if (sy < 0 ? map[1] < 0 : map[1] >= dim) { break; }
+				if (impact[1] > limit[1]) { break; }
+				index += strideY;
+			}
+		} else {
+			if (impact[0] > impact[2]) {
+				collisionInfo.side = 2;
+				impact[2] += deltaDist[2];
+				map[2] += sz;
+				if (sz < 0 ? map[2] < 0 : map[2] >= dim) { break; }
+				if (impact[2] > limit[2]) { break; }
+				index += strideZ;
+			} else {
+				collisionInfo.side = 0;
+				impact[0] += deltaDist[0];
+				map[0] += sx;
+				if (sx < 0 ? map[0] < 0 : map[0] >= dim) { break; }
+				if (impact[0] > limit[0]) { break; }
+				index += sx;
 			}
 		}
-		collisionInfo.impact[collisionInfo.side] += deltaDist[collisionInfo.side];
-		map[collisionInfo.side] += step[collisionInfo.side];
-		if (map[collisionInfo.side] < 0 || map[collisionInfo.side] >= dim) { break; } // out of bounds
 
 		// sample volume data at calculated position and make collision calculations
-		collisionInfo.voxel = volume[map[2]*dim*dim + map[1]*dim + map[0]];
-		if (!collisionInfo.voxel.isEmpty) {
+		if (!volume[index].isEmpty) {
+			collisionInfo.voxel = volume[index];
+			collisionInfo.index = index;
 			break; // closest voxel is found, no more work to be done
 		}
 	}
+	collisionInfo.distance = impact[collisionInfo.side] - deltaDist[collisionInfo.side];
 
 	return collisionInfo;
 }
 
-Renderer::Renderer( void ) : m_color(NULL), m_width(0), m_height(0), m_initialized(false) {}
+// Same traversal in 64-bit fixed point. Side distances are exact integer sums of a
+// per-axis delta, so they do not drift on long rays the way float accumulation does,
+// and the axis to step is picked from a table indexed by the three comparison bits
+// instead of a chain of branches. Near ties are decided exactly, and exact ties
+// resolve towards the lower axis like in the float traversal.
+template < int octant, int Dim >
+CollisionInfo Renderer::GetIntersectionFixed(const Ray &ray, const Voxel *volume, const int p_dim)
+{
+	const int dim = (Dim > 0) ? Dim : p_dim;
+	typedef long long fixed_t;
+	// distances up to MaxDistance, beyond every boundary in the volume, take the integer bits and the rest are
+	// fraction bits (48 for 4096^3), leaving room for the sum of a side distance, a delta and the ray length;
+	// longer deltas and side distances are clamped to it, their axis is never stepped inside the volume
+	int distanceBits = 1;
+	while ((1 << distanceBits) < 2 * dim) { ++distanceBits; }
+	const int FixedBits = 61 - distanceBits;
+	const double FixedOne = double( fixed_t( 1 ) << FixedBits );
+	const double MaxDistance = double( 1 << distanceBits );
+	// side distances carry up to a few thousand units of rounding from double precision, plus half a unit per
+	// delta added; side distances closer than this are compared exactly instead
+	const fixed_t TieBound = 16384 + 4 * fixed_t( dim );
+	static const int SideTable[8] = { 0, 1, 2, 1, 0, 2, 2, 2 };
 
-bool Renderer::Init(int p_width, int p_height, bool p_fullscreen)
+	const int step[3] = { (octant & 1) ? -1 : 1, (octant & 2) ? -1 : 1, (octant & 4) ? -1 : 1 };
+
+	CollisionInfo collisionInfo;
+	collisionInfo.index = -1;
+	collisionInfo.side = 0;
+	collisionInfo.voxel.isEmpty = true;
+
+	int map[3] = { int( ray.origin[0] ), int( ray.origin[1] ), int( ray.origin[2] ) };
+	const double dir[3] = { ray.direction[0], ray.direction[1], ray.direction[2] };
+	const double length = sqrt(dir[0]*dir[0] + dir[1]*dir[1] + dir[2]*dir[2]);
+	fixed_t deltaDist[3];
+	fixed_t impact[3];
+	for (int i = 0; i < 3; ++i) {
+		const double absDir = dir[i] < 0.0 ? -dir[i] : dir[i];
+		const double fraction = (step[i] < 0) ? ray.origin[i] - map[i] : map[i] + 1.0 - ray.origin[i];
+		deltaDist[i] = fixed_t( ((length < absDir * MaxDistance) ? length / absDir : MaxDistance) * FixedOne + 0.5 );
+		impact[i] = fixed_t( ((fraction * length < absDir * MaxDistance) ? fraction * length / absDir : MaxDistance) * FixedOne + 0.5 );
+	}
+
+	const fixed_t end = fixed_t( ((double( ray.length ) < MaxDistance) ? double( ray.length ) : MaxDistance) * FixedOne );
+	const fixed_t limit[3] = { end + deltaDist[0], end + deltaDist[1], end + deltaDist[2] };
+
+	// a resumed ray starts out in the cell it hit, and cells left before ray.start are stepped over, at once
+	// either way since side distances are exact multiples of the deltas
+	if (ray.resume >= 0) {
+		const int cell[3] = { int( ray.resume % dim ), int( ray.resume / dim % dim ), int( ray.resume / dim / dim ) };
+		for (int i = 0; i < 3; ++i) {
+			impact[i] += fixed_t( (cell[i] - map[i]) * step[i] ) * deltaDist[i];
+			map[i] = cell[i];
+		}
+	} else if (ray.start > 0.f) {
+		const fixed_t start = fixed_t( ((double( ray.start ) < MaxDistance) ? double( ray.start ) : MaxDistance) * FixedOne );
+		bool inside = true;
+		for (int i = 0; i < 3; ++i) {
+			if (impact[i] < start) {
+				const fixed_t crossed = (start - impact[i] + deltaDist[i] - 1) / deltaDist[i];
+				impact[i] += crossed * deltaDist[i];
+				map[i] += step[i] * int( crossed );
+				inside = inside && crossed < fixed_t( dim ) && (unsigned int)map[i] < (unsigned int)dim && impact[i] <= limit[i];
+			}
+		}
+		if (!inside || !volume[GetVoxelIndex<Dim>(map, dim)].isEmpty) {
+			Ray full = ray;
+			full.start = 0.f;
+			return GetIntersectionFixed<octant, Dim>(full, volume, p_dim);
+		}
+	}
+
+	const voxel_index_t stride[3] = { step[0], step[1] * dim, step[2] * voxel_index_t( dim ) * dim };
+	voxel_index_t index = GetVoxelIndex<Dim>(map, dim);
+	while (true) {
+		int side = SideTable[(impact[0] > impact[1]) | ((impact[0] > impact[2]) << 1) | ((impact[1] > impact[2]) << 2)];
+		if (impact[(side + 1) % 3] - impact[side] <= TieBound || impact[(side + 2) % 3] - impact[side] <= TieBound) {
+			side = GetExactExitSide(ray, map); // too close to call from the rounded side distances
+		}
+		impact[side] += deltaDist[side];
+		map[side] += step[side];
+		if ((unsigned int)map[side] >= (unsigned int)dim || impact[side] > limit[side]) { // out of bounds on either side, or beyond the end of the ray
+			collisionInfo.side = side;
+			break;
+		}
+		index += stride[side];
+		if (!volume[index].isEmpty) {
+			collisionInfo.side = side;
+			collisionInfo.voxel = volume[index];
+			collisionInfo.index = index;
+			break;
+		}
+	}
+
+	for (int i = 0; i < 3; ++i) {
+		collisionInfo.impact[i] = float( impact[i] / FixedOne );
+	}
+	collisionInfo.distance = float( (impact[collisionInfo.side] - deltaDist[collisionInfo.side]) / FixedOne );
+	return collisionInfo;
+}
+
+template < int Dim >
+const Renderer::IntersectionKernel Renderer::KernelTable<Dim>::Float[8] = {
+	&Renderer::GetIntersection<0, Dim>, &Renderer::GetIntersection<1, Dim>, &Renderer::GetIntersection<2, Dim>, &Renderer::GetIntersection<3, Dim>,
+	&Renderer::GetIntersection<4, Dim>, &Renderer::GetIntersection<5, Dim>, &Renderer::GetIntersection<6, Dim>, &Renderer::GetIntersection<7, Dim>
+};
+
+template < int Dim >
+const Renderer::IntersectionKernel Renderer::KernelTable<Dim>::Fixed[8] = {
+	&Renderer::GetIntersectionFixed<0, Dim>, &Renderer::GetIntersectionFixed<1, Dim>, &Renderer::GetIntersectionFixed<2, Dim>, &Renderer::GetIntersectionFixed<3, Dim>,
+	&Renderer::GetIntersectionFixed<4, Dim>, &Renderer::GetIntersectionFixed<5, Dim>, &Renderer::GetIntersectionFixed<6, Dim>, &Renderer::GetIntersectionFixed<7, Dim>
+};
+
+template < int Dim >
+const Renderer::IntersectionKernel *Renderer::KernelTable<Dim>::Get(TraversalMode p_mode)
 {
-	if (m_initialized) { CleanUp(); }
-	m_initialized = (SDL_SetVideoMode(p_width, p_height, 24, SDL_SWSURFACE|SDL_DOUBLEBUF|(p_fullscreen ? SDL_FULLSCREEN : 0)) != NULL);
-	if (m_initialized) {
-		m_color = (byte_t*)SDL_GetVideoSurface()->pixels;
-		m_width = p_width;
-		m_height = p_height;
+	return (p_mode == TRAVERSE_FIXED) ? Fixed : Float;
+}
+
+const Renderer::IntersectionKernel *Renderer::SelectKernels(TraversalMode p_mode, const int dim)
+{
+	// power of two volumes get kernels with the dimension baked in, anything else uses the generic ones
+	switch (dim) {
+	case 16:	return KernelTable<16>::Get(p_mode);
+	case 32:	return KernelTable<32>::Get(p_mode);
+	case 64:	return KernelTable<64>::Get(p_mode);
+	case 128:	return KernelTable<128>::Get(p_mode);
+	case 256:	return KernelTable<256>::Get(p_mode);
+	case 512:	return KernelTable<512>::Get(p_mode);
+	case 1024:	return KernelTable<1024>::Get(p_mode);
+	case 2048:	return KernelTable<2048>::Get(p_mode);
+	case 4096:	return KernelTable<4096>::Get(p_mode);
+	default:	return KernelTable<0>::Get(p_mode);
 	}
-	return m_initialized;
 }
 
-void Renderer::CleanUp( void )
+// GetExactExitSide, and p_edge set when there is a tie, where the ray runs exactly through an edge or corner
+static int GetReferenceSide(const Ray &ray, const int *map, bool &p_edge)
 {
-	if (SDL_GetVideoSurface() != NULL) {
-		SDL_FreeSurface(SDL_GetVideoSurface());
-		m_color = NULL;
-		m_width = 0;
-		m_height = 0;
-		m_initialized = false;
+	const int side = GetExactExitSide(ray, map);
+	for (int i = 0; i < 3; ++i) {
+		if (i != side && CompareExitDistances(ray, map, i, side) == 0) { p_edge = true; }
 	}
+	return side;
 }
 
-void Renderer::Render(const Camera &camera, const Voxel *volume, const int dim) const
+// Reference traversal for CheckTraversal. The axis to step is decided exactly, without any rounding, so
+// the reference has no drift and no error near edges. The distance it reports is worked out from scratch in
+// long double, as the boundary's offset from the origin times the ray length over the direction component.
+// p_edge is set when the ray runs exactly through a voxel edge on its way.
+static CollisionInfo GetReferenceIntersection(const Ray &ray, const Voxel *volume, const int dim, bool &p_edge)
 {
-	// NOTE: Will not render rays originating from outside a volume correctly. May crash.
+	CollisionInfo collisionInfo;
+	collisionInfo.index = -1;
+	collisionInfo.side = 0;
+	collisionInfo.voxel.isEmpty = true;
 
-	// calculate normals at view port coordinates
-	const vec3_t upperLeftNormal	= mml::Normalize(camera.GetPortVector(Camera::PORT_UPPERLEFT) + camera.GetDirection()); // remove +dir later since that locks FOV
-	const vec3_t upperRightNormal	= mml::Normalize(camera.GetPortVector(Camera::PORT_UPPERRIGHT) + camera.GetDirection());
-	const vec3_t lowerLeftNormal	= mml::Normalize(camera.GetPortVector(Camera::PORT_LOWERLEFT) + camera.GetDirection());
-	const vec3_t lowerRightNormal	= mml::Normalize(camera.GetPortVector(Camera::PORT_LOWERRIGHT) + camera.GetDirection());
+	int map[3] = { int( ray.origin[0] ), int( ray.origin[1] ), int( ray.origin[2] ) };
+	const long double dir[3] = { ray.direction[0], ray.direction[1], ray.direction[2] };
+	const long double length = sqrtl(dir[0]*dir[0] + dir[1]*dir[1] + dir[2]*dir[2]);
+	p_edge = false;
+	while (true) {
+		const int side = GetReferenceSide(ray, map, p_edge);
+		const long double offset = (dir[side] < 0.L) ? (long double)( ray.origin[side] ) - map[side] : map[side] + 1.L - ray.origin[side];
+		collisionInfo.side = side;
+		collisionInfo.distance = float( offset * length / fabsl(dir[side]) );
+		map[side] += (dir[side] < 0.L) ? -1 : 1;
+		if ((unsigned int)map[side] >= (unsigned int)dim) { break; }
+		const voxel_index_t index = GetVoxelIndex<0>(map, dim);
+		if (!volume[index].isEmpty) {
+			collisionInfo.voxel = volume[index];
+			collisionInfo.index = index;
+			break;
+		}
+	}
+	return collisionInfo;
+}
 
-	const float invHeight	= 1.f / (float)m_height;
-	const float invWidth	= 1.f / (float)m_width;
+static void PrintTraversalCell(std::ostream &p_out, const CollisionInfo &p_collisionInfo, const int dim)
+{
+	char cell[96];
+	if (p_collisionInfo.index < 0) {
+		sprintf(cell, "leaves the volume at %.6f", p_collisionInfo.distance);
+	} else {
+		const voxel_index_t plane = voxel_index_t( dim ) * dim;
+		sprintf(cell, "hits (%d %d %d) at %.6f", int( p_collisionInfo.index % dim ), int( p_collisionInfo.index / dim % dim ), int( p_collisionInfo.index / plane ), p_collisionInfo.distance);
+	}
+	p_out << cell;
+}
 
-	// left and right y deltas for normal interpolation
-	const vec3_t leftNormalDelta	= (lowerLeftNormal - upperLeftNormal) * invHeight;
-	const vec3_t rightNormalDelta	= (lowerRightNormal - upperRightNormal) * invHeight;
+void Renderer::TraversalCheck::Clear( void )
+{
+	rays = 0;
+	edges = 0;
+	reports = 0;
+	length = 0.0;
+	for (int m = 0; m < 2; ++m) {
+		differing[m] = 0;
+		maxError[m] = 0.0;
+	}
+}
 
-//#pragma omp parallel for
-	for (int y = 0; y < m_height; ++y) {
+bool Renderer::TraversalCheck::Agrees( void ) const
+{
+	return differing[TRAVERSE_FLOAT] == 0 && differing[TRAVERSE_FIXED] == 0;
+}
+
+void Renderer::TraversalCheck::Print(std::ostream &p_out) const
+{
+	static const char *names[2] = { "float", "fixed" };
+	char line[256];
+	sprintf(line, "%d rays, %.1f voxels long on average, %d through voxel edges", rays, (rays > 0) ? length / rays : 0.0, edges);
+	p_out << line << std::endl;
+	for (int m = 0; m < 2; ++m) {
+		sprintf(line, "%s traversal: %d rays differ from the reference, distances of the others off by up to %.3g", names[m], differing[m], maxError[m]);
+		p_out << line << std::endl;
+	}
+}
+
+void Renderer::CheckRay(const Ray &ray, const char *p_name, const Voxel *volume, const int dim, TraversalCheck &p_check, std::ostream &p_out)
+{
+	static const int MaxReports = 20;
+	static const char *names[2] = { "float", "fixed" };
+
+	bool edge;
+	const CollisionInfo reference = GetReferenceIntersection(ray, volume, dim, edge);
+	++p_check.rays;
+	p_check.length += reference.distance;
+	if (edge) { ++p_check.edges; }
+	for (int m = 0; m < 2; ++m) {
+		const CollisionInfo collisionInfo = SelectKernels(TraversalMode( m ), dim)[GetOctant(ray.direction)](ray, volume, dim);
+		if (collisionInfo.index == reference.index) {
+			p_check.maxError[m] = Max2(p_check.maxError[m], fabs(double( collisionInfo.distance ) - double( reference.distance )));
+			continue;
+		}
+		++p_check.differing[m];
+		if (p_check.reports < MaxReports) {
+			char line[256];
+			sprintf(line, "%s from (%.9g %.9g %.9g) along (%.9g %.9g %.9g): %s ", p_name, ray.origin[0], ray.origin[1], ray.origin[2], ray.direction[0], ray.direction[1], ray.direction[2], names[m]);
+			p_out << line;
+			PrintTraversalCell(p_out, collisionInfo, dim);
+			p_out << ", reference ";
+			PrintTraversalCell(p_out, reference, dim);
+			p_out << (edge ? " (through a voxel edge)" : "") << std::endl;
+			++p_check.reports;
+		}
+	}
+}
+
+// a random point in the volume, or just inside one of its faces so that a ray from it can cross the whole volume
+static vec3_t GetCheckOrigin(Uint32 &random, bool p_onFace, const int dim)
+{
+	vec3_t origin;
+	for (int i = 0; i < 3; ++i) {
+		origin[i] = NextRandom(random) * dim;
+	}
+	if (p_onFace) {
+		const int axis = Min2(int( NextRandom(random) * 3.f ), 2);
+		origin[axis] = (NextRandom(random) < 0.5f) ? 0.5f * NextRandom(random) : dim - 0.5f * NextRandom(random);
+	}
+	return origin;
+}
+
+static vec3_t GetCheckDirection(Uint32 &random)
+{
+	const float z = 2.f * NextRandom(random) - 1.f;
+	const float phi = NextRandom(random) * RAD_MAX;
+	const float radius = sqrt(1.f - z * z);
+	vec3_t direction(radius * cos(phi), radius * sin(phi), z);
+	for (int i = 0; i < 3; ++i) {
+		if (direction[i] == 0.f) { direction[i] = 1e-6f; } // traversal divides by every component
+	}
+	return direction;
+}
 
-		const vec3_t leftNormal = upperLeftNormal + leftNormalDelta * y;
-		const vec3_t rightNormal = upperRightNormal + rightNormalDelta * y;
+// empties the cell the ray starts in and up to p_cells cells it enters after that, stepping like the reference
+static void ClearReferencePath(const Ray &ray, Voxel *volume, const int dim, int p_cells)
+{
+	int map[3] = { int( ray.origin[0] ), int( ray.origin[1] ), int( ray.origin[2] ) };
+	volume[GetVoxelIndex<0>(map, dim)].isEmpty = true;
+	bool edge = false;
+	for (int c = 0; c < p_cells; ++c) {
+		const int side = GetReferenceSide(ray, map, edge);
+		map[side] += (ray.direction[side] < 0.f) ? -1 : 1;
+		if ((unsigned int)map[side] >= (unsigned int)dim) { return; }
+		volume[GetVoxelIndex<0>(map, dim)].isEmpty = true;
+	}
+}
 
+void Renderer::CheckTraversal(const Voxel *volume, const int dim, int p_rays, TraversalCheck &p_check, std::ostream &p_out)
+{
+	for (int r = 0; r < p_rays; ++r) {
+		// every ray follows from its number alone, so a reported one can be traced again
+		Uint32 random = HashUint(Uint32( r ));
 		Ray ray;
-		ray.origin = camera.GetPosition();
-		ray.direction = leftNormal;
-		byte_t *pixel = m_color + m_width * y * 3;
+		int tries = 0;
+		do {
+			// every other ray starts on a face, so that it crosses the whole volume
+			ray.origin = GetCheckOrigin(random, (r & 1) != 0, dim);
+			const int map[3] = { int( ray.origin[0] ), int( ray.origin[1] ), int( ray.origin[2] ) };
+			if (volume[GetVoxelIndex<0>(map, dim)].isEmpty) { break; }
+		} while (++tries < 64);
+		if (tries == 64) { continue; }
+		ray.direction = GetCheckDirection(random);
+		char name[32];
+		sprintf(name, "ray %d", r);
+		CheckRay(ray, name, volume, dim, p_check, p_out);
+	}
+}
+
+void Renderer::CheckTraversalPaths(VolumeMemory &p_volume, int p_rays, TraversalCheck &p_check, std::ostream &p_out)
+{
+	static const int DiscardRays = 64; // the volume is made solid again after this many rays, bounding the memory it takes
 
-		// calculate new x delta
-		const vec3_t normalXDelta = (rightNormal - leftNormal) * invWidth;
+	Voxel *volume = p_volume.GetVoxels();
+	const int dim = p_volume.GetDim();
+	for (int r = 0; r < p_rays; ++r) {
+		// like CheckTraversal, but every ray's path is emptied first, all the way across the volume for every
+		// other ray and up to a random cell for the rest, where the ray then has to stop
+		Uint32 random = HashUint(Uint32( r ));
+		Ray ray;
+		ray.origin = GetCheckOrigin(random, (r & 1) != 0, dim);
+		ray.direction = GetCheckDirection(random);
+		if (r % 8 >= 4) {
+			// from the middle of a cell along whole numbers, which runs through voxel edges time and again
+			for (int i = 0; i < 3; ++i) {
+				ray.origin[i] = Min2(floorf(ray.origin[i]), float( dim - 1 )) + 0.5f;
+				ray.direction[i] = floorf(ray.direction[i] * 8.f + 0.5f);
+				if (ray.direction[i] == 0.f) { ray.direction[i] = 1.f; }
+			}
+		}
+		ClearReferencePath(ray, volume, dim, (r & 2) ? 3 * dim : int( NextRandom(random) * 2.f * dim ));
+		char name[32];
+		sprintf(name, "path %d", r);
+		CheckRay(ray, name, volume, dim, p_check, p_out);
+		if (r % DiscardRays == DiscardRays - 1) {
+			p_volume.DiscardSparse();
+		}
+	}
+}
 
-		for(int x = 0; x < m_width; ++x) {
+void Renderer::CheckTraversal(const Camera &camera, const char *p_view, const Voxel *volume, const int dim, TraversalCheck &p_check, std::ostream &p_out) const
+{
+	// the primary rays Render traces, row by row
+	const Frustum frustum = GetFrustum(camera);
+	for (int y = 0; y < m_height; ++y) {
+		vec3_t direction, step;
+		frustum.GetRow(y, direction, step);
+		for (int x = 0; x < m_width; ++x, direction += step) {
+			Ray ray;
+			ray.origin = camera.GetPosition();
+			ray.direction = direction;
+			char name[96];
+			sprintf(name, "%.48s pixel (%d %d)", p_view, x, y);
+			CheckRay(ray, name, volume, dim, p_check, p_out);
+		}
+	}
+}
 
-			CollisionInfo collisionInfo = GetIntersection(ray, volume, dim);
+CollisionInfo Renderer::GetIntersection(const Ray &ray, const Voxel *volume, const int dim) const
+{
+	return m_kernels[GetOctant(ray.direction)](ray, volume, dim);
+}
 
-			// draw pixel on screen
-			if (!collisionInfo.voxel.isEmpty) {
-				pixel[0] = collisionInfo.voxel.rgb[0] >> collisionInfo.side;
-				pixel[1] = collisionInfo.voxel.rgb[1] >> collisionInfo.side;
-				pixel[2] = collisionInfo.voxel.rgb[2] >> collisionInfo.side;
+bool Renderer::GetIntersectionFrom(const Ray &ray, float start, const Voxel *volume, const int dim, CollisionInfo &collisionInfo) const
+{
+	const vec3_t from = ray.origin + ray.direction * (start / ray.direction.Len());
+	const int map[3] = { int( from[0] ), int( from[1] ), int( from[2] ) };
+	if (
+		from[0] >= 0.f && map[0] < dim &&
+		from[1] >= 0.f && map[1] < dim &&
+		from[2] >= 0.f && map[2] < dim &&
+		volume[GetVoxelIndex<0>(map, dim)].isEmpty
+	) {
+		Ray skipped = ray;
+		skipped.start = start;
+		collisionInfo = GetIntersection(skipped, volume, dim);
+		return true;
+	}
+	return false;
+}
+
+CollisionInfo Renderer::GetPrimaryIntersection(const Ray &ray, int x, int y, const Voxel *volume, const int dim) const
+{
+	Ray bounded = ray;
+	float start = 0.f;
+	if (m_splatting) {
+		const float near = m_rayNear[y * m_width + x];
+		const float far = m_rayFar[y * m_width + x];
+		if (near > far) {
+			// no occupied brick lies along the ray
+			CollisionInfo collisionInfo;
+			collisionInfo.impact = vec3_t(FLT_MAX, FLT_MAX, FLT_MAX);
+			collisionInfo.index = -1;
+			collisionInfo.side = 0;
+			collisionInfo.distance = FLT_MAX;
+			collisionInfo.voxel.isEmpty = true;
+			return collisionInfo;
+		}
+		start = near;
+		bounded.length = far;
+	}
+
+	CollisionInfo collisionInfo;
+	const float skip = m_tileStart[(y / TileSize) * m_tilesX + x / TileSize];
+	if (skip > start && skip < bounded.length) {
+		// a hit right after the start point may belong to something that reaches into the skipped part
+		if (GetIntersectionFrom(bounded, skip, volume, dim, collisionInfo) && (collisionInfo.index < 0 || collisionInfo.distance - skip >= SkipMargin)) {
+			return collisionInfo;
+		}
+		// the skip was invalid, trace from the start of the interval
+	}
+	if (start > 0.f && GetIntersectionFrom(bounded, start, volume, dim, collisionInfo)) {
+		return collisionInfo;
+	}
+	return GetIntersection(bounded, volume, dim);
+}
+
+void Renderer::Splat(const Camera &camera, const Frustum &frustum, const Voxel *volume, const int dim) const
+{
+	if (!m_bricks.IsBuiltFor(volume, dim)) {
+		m_bricks.Build(volume, dim);
+	}
+	for (int i = 0; i < m_rayNear.GetSize(); ++i) {
+		m_rayNear[i] = FLT_MAX;
+		m_rayFar[i] = 0.f;
+	}
+
+	// primary ray directions are affine in the pixel coordinates, dir(x,y) = upperLeft + dx*x + dy*y,
+	// so a point v (relative to the camera) solves v = w*upperLeft + (w*x)*dx + (w*y)*dy
+	const vec3_t origin = camera.GetPosition();
+	const vec3_t dx = (frustum.upperRight - frustum.upperLeft) * frustum.invWidth;
+	const vec3_t dy = frustum.leftDelta;
+	const vec3_t normal = mml::Cross(dx, dy);
+	const float invDet = 1.f / mml::Dot(frustum.upperLeft, normal);
+
+	FrameArena &arena = GetThreadArena();
+	SplatRect *rects = arena.Allocate<SplatRect>(m_bricks.GetOccupiedCount());
+	int rectCount = 0;
+	for (int b = 0; b < m_bricks.GetOccupiedCount(); ++b) {
+
+		// brick bounds, grown a little so that rays grazing an edge are not lost to rounding
+		const BrickMap::Brick &brick = m_bricks.GetOccupied(b);
+		float *boxMin = rects[rectCount].boxMin;
+		float *boxMax = rects[rectCount].boxMax;
+		for (int i = 0; i < 3; ++i) {
+			boxMin[i] = float( brick.min[i] ) - SplatMargin;
+			boxMax[i] = float( brick.max[i] ) + SplatMargin;
+		}
+
+		// screen rectangle of the projected corners, or the whole screen when the box reaches behind the camera
+		int x0 = 0, y0 = 0, x1 = m_width - 1, y1 = m_height - 1;
+		float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+		bool inFront = true;
+		for (int c = 0; c < 8 && inFront; ++c) {
+			const vec3_t v = vec3_t((c & 1) ? boxMax[0] : boxMin[0], (c & 2) ? boxMax[1] : boxMin[1], (c & 4) ? boxMax[2] : boxMin[2]) - origin;
+			const float w = mml::Dot(v, normal) * invDet;
+			if (w <= 0.f) {
+				inFront = false;
 			} else {
-#ifdef _DEBUG
-				pixel[color24::r] = (ray.direction[0] < 0.f) ? 255 : 0; // -x = red
-				pixel[color24::g] = (ray.direction[1] < 0.f) ? 255 : 0; // -y = green
-				pixel[color24::b] = (ray.direction[2] < 0.f) ? 255 : 0; // -z = blue
-#else
-				pixel[0] = 0;
-				pixel[1] = 0;
-				pixel[2] = 0;
-#endif
+				const float px = mml::Dot(frustum.upperLeft, mml::Cross(v, dy)) * invDet / w;
+				const float py = mml::Dot(frustum.upperLeft, mml::Cross(dx, v)) * invDet / w;
+				minX = Min2(minX, px);
+				maxX = Max2(maxX, px);
+				minY = Min2(minY, py);
+				maxY = Max2(maxY, py);
 			}
+		}
+		if (inFront) {
+			if (maxX < -1.f || maxY < -1.f || minX > float( m_width ) || minY > float( m_height )) { continue; }
+			x0 = Max2(int( floor(minX) ) - 1, 0);
+			y0 = Max2(int( floor(minY) ) - 1, 0);
+			x1 = Min2(int( ceil(maxX) ) + 1, m_width - 1);
+			y1 = Min2(int( ceil(maxY) ) + 1, m_height - 1);
+		}
+		rects[rectCount].x0 = x0;
+		rects[rectCount].y0 = y0;
+		rects[rectCount].x1 = x1;
+		rects[rectCount].y1 = y1;
+		++rectCount;
+	}
 
-			// interpolate x
-			ray.direction += normalXDelta;
+	// bin the rectangles by the bands of TileSize rows they cover, so that bands can be filled in parallel
+	const int bandCount = (m_height + TileSize - 1) / TileSize;
+	int *bandStart = arena.Allocate<int>(bandCount + 1);
+	int *bandFill = arena.Allocate<int>(bandCount);
+	for (int band = 0; band <= bandCount; ++band) {
+		bandStart[band] = 0;
+	}
+	for (int r = 0; r < rectCount; ++r) {
+		for (int band = rects[r].y0 / TileSize; band <= rects[r].y1 / TileSize; ++band) {
+			++bandStart[band + 1];
+		}
+	}
+	for (int band = 0; band < bandCount; ++band) {
+		bandStart[band + 1] += bandStart[band];
+		bandFill[band] = bandStart[band];
+	}
+	int *bandRects = arena.Allocate<int>(bandStart[bandCount]);
+	for (int r = 0; r < rectCount; ++r) {
+		for (int band = rects[r].y0 / TileSize; band <= rects[r].y1 / TileSize; ++band) {
+			bandRects[bandFill[band]++] = r;
+		}
+	}
 
-			// step to next pixel (3 byte channels)
-			pixel += 3;
+	// widen each covered pixel's interval by where its ray enters and leaves the box
+#pragma omp parallel for schedule(dynamic)
+	for (int band = 0; band < bandCount; ++band) {
+		for (int r = bandStart[band]; r < bandStart[band + 1]; ++r) {
+			const SplatRect &rect = rects[bandRects[r]];
+			const float *boxMin = rect.boxMin;
+			const float *boxMax = rect.boxMax;
+			for (int y = Max2(rect.y0, band * (int)TileSize); y <= Min2(rect.y1, band * (int)TileSize + (int)TileSize - 1); ++y) {
+				float *near = m_rayNear.GetData() + y * m_width;
+				float *far = m_rayFar.GetData() + y * m_width;
+				for (int x = rect.x0; x <= rect.x1; ++x) {
+					const vec3_t direction = frustum.GetDirection(float( x ), float( y ));
+					const float invLen = 1.f / direction.Len();
+					float enter = 0.f, exit = FLT_MAX;
+					for (int i = 0; i < 3; ++i) {
+						const float d = direction[i] * invLen;
+						if (d == 0.f) {
+							if (origin[i] < boxMin[i] || origin[i] > boxMax[i]) { exit = -1.f; }
+						} else {
+							const float t0 = (boxMin[i] - origin[i]) / d;
+							const float t1 = (boxMax[i] - origin[i]) / d;
+							enter = Max2(enter, Min2(t0, t1));
+							exit = Min2(exit, Max2(t0, t1));
+						}
+					}
+					if (enter <= exit) {
+						near[x] = Min2(near[x], enter);
+						far[x] = Max2(far[x], exit);
+					}
+				}
+			}
 		}
 	}
 }
 
-void Renderer::Refresh( void ) const
+void Renderer::PrepareSkip(const Camera &camera, const Frustum &frustum) const
+{
+	// a point seen last frame now lies in another direction by the camera's rotation plus its parallax, at
+	// most the distance moved over the closest depth; the neighbourhood searched for the closest hit is made
+	// as many tiles wide as that, measured at a corner tile where pixels span the smallest angle
+	int radius = 0;
+	const vec3_t offset = camera.GetPosition() - m_prevPosition;
+	const float moved = offset.Len();
+	if (m_temporalSkip && m_skipHistory) {
+		const vec3_t corner = mml::Normalize(frustum.GetDirection(0.f, 0.f));
+		const float tileAngle = Min2(
+			acos(Min2(mml::Dot(corner, mml::Normalize(frustum.GetDirection(float( TileSize ), 0.f))), 1.f)),
+			acos(Min2(mml::Dot(corner, mml::Normalize(frustum.GetDirection(0.f, float( TileSize )))), 1.f))
+		);
+		float closest = FLT_MAX;
+		for (int i = 0; i < m_tileDepth.GetSize(); ++i) {
+			closest = Min2(closest, m_tileDepth[i]);
+		}
+		const float rotation = acos(Max2(Min2(mml::Dot(camera.GetDirection(), m_prevDirection), 1.f), -1.f));
+		const float parallax = (moved <= 0.f) ? 0.f : ((closest > moved) ? atan(moved / (closest - moved)) : float( PI ));
+		const float shift = rotation + parallax;
+		if (tileAngle > 0.f && shift <= tileAngle * MaxSkipRadius) {
+			radius = Max2(int( ceil(shift / tileAngle) ), 1);
+		}
+		// the space around a camera that left the previous view frustum, e.g. sideways, was never seen
+		for (int i = 0; i < 4 && radius > 0; ++i) {
+			if (mml::Dot(offset, m_prevPlanes[i]) < 0.f) { radius = 0; }
+		}
+	}
+	if (radius == 0) {
+		for (int i = 0; i < m_tileStart.GetSize(); ++i) {
+			m_tileStart[i] = 0.f;
+		}
+		return;
+	}
+
+	for (int ty = 0; ty < m_tilesY; ++ty) {
+		for (int tx = 0; tx < m_tilesX; ++tx) {
+			float depth = m_tileDepth[ty * m_tilesX + tx];
+			for (int ny = Max2(ty - radius, 0); ny <= Min2(ty + radius, m_tilesY - 1); ++ny) {
+				for (int nx = Max2(tx - radius, 0); nx <= Min2(tx + radius, m_tilesX - 1); ++nx) {
+					depth = Min2(depth, m_tileDepth[ny * m_tilesX + nx]);
+				}
+			}
+			// only what lay inside the previous view frustum was seen; the tile's rays are kept to that by
+			// where its corner rays leave it, pulled in by the angle between corners for the rays in between
+			const float x0 = float( tx * TileSize ), x1 = float( Min2((tx + 1) * (int)TileSize, m_width) - 1 );
+			const float y0 = float( ty * TileSize ), y1 = float( Min2((ty + 1) * (int)TileSize, m_height) - 1 );
+			const vec3_t corners[4] = {
+				mml::Normalize(frustum.GetDirection(x0, y0)), mml::Normalize(frustum.GetDirection(x1, y0)),
+				mml::Normalize(frustum.GetDirection(x0, y1)), mml::Normalize(frustum.GetDirection(x1, y1))
+			};
+			float seen = FLT_MAX;
+			for (int c = 0; c < 4; ++c) {
+				for (int i = 0; i < 4; ++i) {
+					const float towards = mml::Dot(corners[c], m_prevPlanes[i]);
+					if (towards < 0.f) { seen = Min2(seen, mml::Dot(offset, m_prevPlanes[i]) / -towards); }
+				}
+			}
+			seen *= Min2(mml::Dot(corners[0], corners[3]), mml::Dot(corners[1], corners[2]));
+			m_tileStart[ty * m_tilesX + tx] = Max2(Min2(depth - moved, seen) - SkipMargin, 0.f);
+		}
+	}
+}
+
+void Renderer::UpdateSkip(const Camera &camera, const Frustum &frustum) const
+{
+	if (!m_temporalSkip) {
+		m_skipHistory = false;
+		return;
+	}
+	for (int ty = 0; ty < m_tilesY; ++ty) {
+		for (int tx = 0; tx < m_tilesX; ++tx) {
+			const int x1 = Min2((tx + 1) * (int)TileSize, m_width);
+			const int y1 = Min2((ty + 1) * (int)TileSize, m_height);
+			float depth = m_depth[ty * TileSize * m_width + tx * TileSize];
+			for (int y = ty * TileSize; y < y1; ++y) {
+				for (int x = tx * TileSize; x < x1; ++x) {
+					depth = Min2(depth, m_depth[y * m_width + x]);
+				}
+			}
+			m_tileDepth[ty * m_tilesX + tx] = depth;
+		}
+	}
+	m_prevPosition = camera.GetPosition();
+	m_prevDirection = camera.GetDirection();
+	// side planes through the camera and neighbouring corner rays, normals pointing into the frustum
+	const vec3_t lowerLeft = frustum.upperLeft + frustum.leftDelta * float( m_height );
+	const vec3_t lowerRight = frustum.upperRight + frustum.rightDelta * float( m_height );
+	const vec3_t corners[5] = { frustum.upperLeft, frustum.upperRight, lowerRight, lowerLeft, frustum.upperLeft };
+	const vec3_t center = frustum.upperLeft + frustum.upperRight + lowerLeft + lowerRight;
+	for (int i = 0; i < 4; ++i) {
+		m_prevPlanes[i] = mml::Cross(corners[i], corners[i + 1]);
+		if (mml::Dot(m_prevPlanes[i], center) < 0.f) { m_prevPlanes[i] = -m_prevPlanes[i]; }
+	}
+	m_skipHistory = true;
+}
+
+vec3_t Renderer::Frustum::GetDirection(float x, float y) const
+{
+	const vec3_t left = upperLeft + leftDelta * y;
+	const vec3_t right = upperRight + rightDelta * y;
+	return left + (right - left) * (x * invWidth);
+}
+
+void Renderer::Frustum::GetRow(int y, vec3_t &first, vec3_t &step) const
+{
+	first = upperLeft + leftDelta * y;
+	const vec3_t last = upperRight + rightDelta * y;
+	step = (last - first) * invWidth;
+}
+
+Renderer::Frustum Renderer::GetFrustum(const Camera &camera) const
+{
+	// calculate normals at view port coordinates
+	const vec3_t upperLeftNormal	= mml::Normalize(camera.GetPortVector(Camera::PORT_UPPERLEFT) + camera.GetDirection()); // remove +dir later since that locks FOV
+	const vec3_t upperRightNormal	= mml::Normalize(camera.GetPortVector(Camera::PORT_UPPERRIGHT) + camera.GetDirection());
+	const vec3_t lowerLeftNormal	= mml::Normalize(camera.GetPortVector(Camera::PORT_LOWERLEFT) + camera.GetDirection());
+	const vec3_t lowerRightNormal	= mml::Normalize(camera.GetPortVector(Camera::PORT_LOWERRIGHT) + camera.GetDirection());
+
+	const float invHeight = 1.f / (float)m_height;
+
+	Frustum frustum;
+	frustum.upperLeft = upperLeftNormal;
+	frustum.upperRight = upperRightNormal;
+	// left and right y deltas for normal interpolation
+	frustum.leftDelta = (lowerLeftNormal - upperLeftNormal) * invHeight;
+	frustum.rightDelta = (lowerRightNormal - upperRightNormal) * invHeight;
+	frustum.invWidth = 1.f / (float)m_width;
+	return frustum;
+}
+
+void Renderer::AntiAlias(const Frustum &frustum, const Camera &camera, const Voxel *volume, const int dim) const
+{
+	const unsigned int *ids = m_hitIds.GetData();
+	const float invSamples = 1.f / float( m_aaSamples );
+
+#pragma omp parallel for schedule(dynamic)
+	for (int y = 0; y < m_height; ++y) {
+
+		Ray ray;
+		ray.origin = camera.GetPosition();
+		const unsigned int *id = ids + m_width * y;
+		pixel_t *pixel = m_color + m_width * y;
+		const Voxel *voxels = GetThreadVolume(volume);
+
+		// only pixels on a discontinuity in the primary hits are supersampled, queue those first
+		FrameArena &arena = GetThreadArena();
+		const FrameArena::Mark mark = arena.GetMark();
+		int *edges = arena.Allocate<int>(m_width);
+		int edgeCount = 0;
+		for (int x = 0; x < m_width; ++x) {
+			const unsigned int center = id[x];
+			if (
+				(x > 0				&& id[x-1] != center) ||
+				(x < m_width-1		&& id[x+1] != center) ||
+				(y > 0				&& id[x-m_width] != center) ||
+				(y < m_height-1		&& id[x+m_width] != center)
+			) {
+				edges[edgeCount++] = x;
+			}
+		}
+
+		for (int e = 0; e < edgeCount; ++e) {
+			const int x = edges[e];
+			float sum[3] = { 0.f, 0.f, 0.f };
+			for (int s = 0; s < m_aaSamples; ++s) {
+				ray.direction = frustum.GetDirection(x + m_aaOffsets[s][0], y + m_aaOffsets[s][1]);
+				int rgb[3];
+				const CollisionInfo collisionInfo = GetIntersection(ray, voxels, dim);
+				ShadeHit(ray, collisionInfo, voxels, dim, rgb);
+				sum[0] += rgb[0];
+				sum[1] += rgb[1];
+				sum[2] += rgb[2];
+			}
+			const int rgb[3] = { int( sum[0] * invSamples + 0.5f ), int( sum[1] * invSamples + 0.5f ), int( sum[2] * invSamples + 0.5f ) };
+			pixel[x] = PackPixel(rgb);
+		}
+		CountRays(edgeCount * m_aaSamples);
+		arena.Rewind(mark);
+	}
+}
+
+Renderer::TileRate Renderer::GetTileRate(int p_tileX, int p_tileY) const
+{
+	if (m_vrsMode == VRS_CONTENT) {
+		const int idCount = m_tileIdCounts[p_tileY * m_tilesX + p_tileX];
+		if (idCount <= 1) { return RATE_QUARTER; }
+		if (idCount == 2) { return RATE_HALF; }
+		return RATE_FULL;
+	}
+
+	const float invHeight = 1.f / (float)m_height;
+	const float dx = ((p_tileX + 0.5f) * TileSize - m_focus[0] * m_width) * invHeight;
+	const float dy = ((p_tileY + 0.5f) * TileSize - m_focus[1] * m_height) * invHeight;
+	const float dist = sqrt(dx*dx + dy*dy);
+	if (dist <= m_fullRadius) { return RATE_FULL; }
+	if (dist <= m_halfRadius) { return RATE_HALF; }
+	return RATE_QUARTER;
+}
+
+void Renderer::RenderTile(const Camera &camera, const Voxel *volume, const int dim, int p_tileX, int p_tileY, TileRate p_rate) const
+{
+	const int x0 = p_tileX * TileSize;
+	const int y0 = p_tileY * TileSize;
+	const int x1 = Min2(x0 + (int)TileSize, m_width);
+	const int y1 = Min2(y0 + (int)TileSize, m_height);
+	unsigned int *ids = m_hitIds.GetData();
+
+	// trace the sparse set of pixels, in the screen order
+	for (int i = 0; i < TileSize * TileSize; ++i) {
+		const int x = x0 + m_pixelOrder[i] % TileSize;
+		const int y = y0 + m_pixelOrder[i] / TileSize;
+		if (x >= x1 || y >= y1) { continue; }
+		if (p_rate == RATE_FULL || (p_rate == RATE_HALF && ((x + y) & 1) == 0) || (p_rate == RATE_QUARTER && ((x | y) & 1) == 0)) {
+			TracePixel(camera, volume, dim, x, y);
+		}
+	}
+
+	// fill in the gaps; a pixel whose traced neighbours all agree on the hit id gets the same color,
+	// anything else is traced
+	if (p_rate != RATE_FULL) {
+		for (int y = y0; y < y1; ++y) {
+			for (int x = x0; x < x1; ++x) {
+				int neighbours[4][2];
+				int count = 0;
+				if (p_rate == RATE_HALF) {
+					if (((x + y) & 1) == 0) { continue; }
+					const int n[4][2] = { {x-1, y}, {x+1, y}, {x, y-1}, {x, y+1} };
+					memcpy(neighbours, n, sizeof(n));
+					count = 4;
+				} else {
+					if (((x | y) & 1) == 0) { continue; }
+					if ((y & 1) == 0) {
+						const int n[2][2] = { {x-1, y}, {x+1, y} };
+						memcpy(neighbours, n, sizeof(n));
+						count = 2;
+					} else if ((x & 1) == 0) {
+						const int n[2][2] = { {x, y-1}, {x, y+1} };
+						memcpy(neighbours, n, sizeof(n));
+						count = 2;
+					} else {
+						const int n[4][2] = { {x-1, y-1}, {x+1, y-1}, {x-1, y+1}, {x+1, y+1} };
+						memcpy(neighbours, n, sizeof(n));
+						count = 4;
+					}
+				}
+
+				int source = -1;
+				int agree = 0;
+				for (int i = 0; i < count; ++i) {
+					const int nx = neighbours[i][0];
+					const int ny = neighbours[i][1];
+					if (nx < x0 || nx >= x1 || ny < y0 || ny >= y1) { continue; } // only this tile's samples are known to be traced
+					const int index = ny * m_width + nx;
+					if (source < 0) {
+						source = index;
+					} else if (ids[index] != ids[source]) {
+						agree = 0;
+						break;
+					}
+					++agree;
+				}
+
+				if (agree >= 2) {
+					const int index = y * m_width + x;
+					ids[index] = ids[source];
+					m_depth[index] = m_depth[source];
+					m_color[index] = m_color[source];
+				} else {
+					TracePixel(camera, volume, dim, x, y);
+				}
+			}
+		}
+	}
+
+	// remember how uniform the tile was for content based rates next frame
+	unsigned int found[2] = { ids[y0 * m_width + x0], 0 };
+	int idCount = 1;
+	for (int y = y0; y < y1 && idCount < 3; ++y) {
+		for (int x = x0; x < x1 && idCount < 3; ++x) {
+			const unsigned int id = ids[y * m_width + x];
+			if (id != found[0] && (idCount == 1 || id != found[1])) {
+				if (idCount < 2) { found[idCount] = id; }
+				++idCount;
+			}
+		}
+	}
+	m_tileIdCounts[p_tileY * m_tilesX + p_tileX] = idCount;
+}
+
+void Renderer::PrepareColumnDirections(const Frustum &frustum) const
+{
+	// stepped along each row like RenderRows does, so that pixels traced on their own get bit for bit the same ray
+#pragma omp parallel for
+	for (int y = 0; y < m_height; ++y) {
+		vec3_t direction, step;
+		frustum.GetRow(y, direction, step);
+		m_rowSteps[y] = step;
+		vec3_t *columns = m_columnDirections.GetData() + y * m_tilesX;
+		for (int x = 0; x < m_width; ++x) {
+			if (x % TileSize == 0) { columns[x / TileSize] = direction; }
+			direction += step;
+		}
+	}
+}
+
+vec3_t Renderer::GetPixelDirection(int x, int y) const
+{
+	const vec3_t &step = m_rowSteps[y];
+	vec3_t direction = m_columnDirections[y * m_tilesX + x / TileSize];
+	for (int i = x - x % TileSize; i < x; ++i) {
+		direction += step;
+	}
+	return direction;
+}
+
+void Renderer::TracePixel(const Camera &camera, const Voxel *volume, const int dim, int x, int y) const
+{
+	Ray ray;
+	ray.origin = camera.GetPosition();
+	ray.direction = GetPixelDirection(x, y);
+	const CollisionInfo collisionInfo = GetPrimaryIntersection(ray, x, y, volume, dim);
+	CountRays(1);
+
+	const int index = y * m_width + x;
+	m_depth[index] = collisionInfo.distance;
+	int rgb[3];
+	ShadeHit(ray, collisionInfo, volume, dim, rgb);
+	m_color[index] = PackPixel(rgb);
+	m_hitIds[index] = GetHitId(collisionInfo);
+}
+
+unsigned int Renderer::GetHitId(const CollisionInfo &collisionInfo)
+{
+	// indices past 2^30 are folded in, ids only need to differ between neighbouring pixels
+	return (collisionInfo.index < 0) ? 0xffffffff : ((unsigned int)(collisionInfo.index ^ (collisionInfo.index >> 30)) << 2) | (unsigned int)collisionInfo.side;
+}
+
+int Renderer::GetBrightness(const CollisionInfo &collisionInfo, const vec3_t &direction) const
+{
+	if (!m_lightActive || collisionInfo.index < 0) { return 256; }
+
+	// light of the empty voxel in front of the face that was hit
+	const int dim = m_light->GetDim();
+	const int axis = collisionInfo.side;
+	const voxel_index_t stride = (axis == 0) ? 1 : ((axis == 1) ? dim : voxel_index_t( dim ) * dim);
+	const int coordinate = int( (collisionInfo.index / stride) % dim );
+	const int step = (direction[axis] < 0.f) ? 1 : -1;
+	if (coordinate + step < 0 || coordinate + step >= dim) {
+		return m_lightBrightness[LightVolume::MaxLevel];
+	}
+	return m_lightBrightness[m_light->GetLevel(int( collisionInfo.index + step * stride ))];
+}
+
+void Renderer::Shade(const CollisionInfo &collisionInfo, const vec3_t &direction, int brightness, int *rgb)
+{
+	if (!collisionInfo.voxel.isEmpty) {
+		rgb[0] = ((collisionInfo.voxel.rgb[0] >> collisionInfo.side) * brightness) >> 8;
+		rgb[1] = ((collisionInfo.voxel.rgb[1] >> collisionInfo.side) * brightness) >> 8;
+		rgb[2] = ((collisionInfo.voxel.rgb[2] >> collisionInfo.side) * brightness) >> 8;
+	} else {
+#ifdef _DEBUG
+		rgb[color24::r] = (direction[0] < 0.f) ? 255 : 0; // -x = red
+		rgb[color24::g] = (direction[1] < 0.f) ? 255 : 0; // -y = green
+		rgb[color24::b] = (direction[2] < 0.f) ? 255 : 0; // -z = blue
+#else
+		(void)direction;
+		rgb[0] = 0;
+		rgb[1] = 0;
+		rgb[2] = 0;
+#endif
+	}
+}
+
+void Renderer::ShadeHit(const Ray &ray, const CollisionInfo &collisionInfo, const Voxel *volume, const int dim, int *rgb) const
+{
+	Shade(collisionInfo, ray.direction, GetBrightness(collisionInfo, ray.direction), rgb);
+	if (m_opacity == NULL || collisionInfo.index < 0 || m_opacity[collisionInfo.index] == 255) { return; }
+
+	// front to back: every translucent voxel adds its color by its opacity and what is left of the ray's
+	// transmittance, and the traversal carries on from that voxel until it reaches an opaque one, leaves the
+	// volume, or is all but blocked, in which case the last voxel takes what is left
+	float sum[3] = { 0.f, 0.f, 0.f };
+	float transmittance = 1.f;
+	CollisionInfo hit = collisionInfo;
+	Ray next = ray;
+	next.start = 0.f;
+	for (;;) {
+		const float alpha = m_opacity[hit.index] * (1.f / 255.f);
+		for (int i = 0; i < 3; ++i) {
+			sum[i] += transmittance * alpha * rgb[i];
+		}
+		transmittance *= 1.f - alpha;
+		if (transmittance <= TranslucentCutoff) { break; }
+
+		next.resume = hit.index;
+		hit = GetIntersection(next, volume, dim);
+		Shade(hit, ray.direction, GetBrightness(hit, ray.direction), rgb);
+		if (hit.index < 0 || m_opacity[hit.index] == 255) { break; }
+	}
+	for (int i = 0; i < 3; ++i) {
+		rgb[i] = Min2(int( sum[i] + transmittance * rgb[i] + 0.5f ), 255);
+	}
+}
+
+void Renderer::InitBuffers(int p_width, int p_height)
+{
+	m_hitIds.Resize(p_width * p_height);
+	m_tilesX = (p_width + TileSize - 1) / TileSize;
+	m_tilesY = (p_height + TileSize - 1) / TileSize;
+	m_tileIdCounts.Resize(m_tilesX * m_tilesY);
+	m_columnDirections.Resize(m_tilesX * p_height);
+	m_rowSteps.Resize(p_height);
+	for (int i = 0; i < m_tileIdCounts.GetSize(); ++i) {
+		m_tileIdCounts[i] = 3; // nothing is known, trace everything in the first frame
+	}
+	m_depth.Resize(p_width * p_height);
+	m_rayNear.Resize(p_width * p_height);
+	m_rayFar.Resize(p_width * p_height);
+	m_tileDepth.Resize(m_tilesX * m_tilesY);
+	m_tileStart.Resize(m_tilesX * m_tilesY);
+	m_refined.Resize(p_width * p_height);
+	m_tileLevels.Free();
+	m_tileErrors.Free();
+	m_skipHistory = false;
+	UpdateOrders();
+}
+
+void Renderer::UpdateOrders( void )
+{
+	// curves cover the smallest power of two square around the tiles, points outside are left out
+	int side = 1;
+	while (side < m_tilesX || side < m_tilesY) { side *= 2; }
+	m_tileOrder.Resize(0);
+	for (int i = 0; i < side * side && m_tileOrder.GetSize() < m_tilesX * m_tilesY; ++i) {
+		int x, y;
+		if (m_order == ORDER_MORTON)		{ GetMortonPoint(i, x, y); }
+		else if (m_order == ORDER_HILBERT)	{ GetHilbertPoint(side, i, x, y); }
+		else								{ x = i % m_tilesX; y = i / m_tilesX; }
+		if (x < m_tilesX && y < m_tilesY) {
+			m_tileOrder.PushBack(y * m_tilesX + x);
+		}
+	}
+	for (int i = 0; i < TileSize * TileSize; ++i) {
+		int x, y;
+		if (m_order == ORDER_MORTON)		{ GetMortonPoint(i, x, y); }
+		else if (m_order == ORDER_HILBERT)	{ GetHilbertPoint(TileSize, i, x, y); }
+		else								{ x = i % TileSize; y = i / TileSize; }
+		m_pixelOrder[i] = y * TileSize + x;
+	}
+}
+
+Renderer::Renderer( void ) : m_color(NULL), m_sink(NULL), m_ownedSink(NULL), m_locked(false), m_width(0), m_height(0), m_initialized(false), m_aaSamples(0), m_vrsMode(VRS_OFF), m_focus(0.5f, 0.5f), m_fullRadius(0.25f), m_halfRadius(0.5f), m_tilesX(0), m_tilesY(0), m_traversal(TRAVERSE_FLOAT), m_order(ORDER_ROWS), m_kernels(KernelTable<0>::Float), m_temporalSkip(false), m_skipHistory(false), m_splatting(false), m_volumeGeneration(0), m_frameCurrent(false), m_frameVolume(NULL), m_frameDim(0), m_frameGeneration(0), m_light(NULL), m_lightActive(false), m_frameLight(NULL), m_frameLightGeneration(0), m_opacity(NULL), m_frameOpacity(NULL), m_giSamples(0), m_giPending(0), m_timeBudget(0.f), m_refinePending(0), m_arenas(NULL), m_arenaCount(0), m_placement(PLACE_OFF), m_nodeCount(1), m_replicate(false), m_replicaSource(NULL), m_replicaDim(0), m_replicaGeneration(0), m_instrumented(false), m_perfEnabled(false)
+{
+	memset(&m_counters, 0, sizeof(m_counters));
+
+	// each light level below the maximum takes away a fifth of the brightness
+	for (int level = 0; level <= LightVolume::MaxLevel; ++level) {
+		m_lightBrightness[level] = int( 256.f * pow(0.8f, float( LightVolume::MaxLevel - level )) + 0.5f );
+	}
+}
+
+Renderer::~Renderer( void )
+{
+	CleanUp();
+	ClosePerfCounters();
+}
+
+bool Renderer::Init(int p_width, int p_height, bool p_fullscreen)
+{
+	if (m_initialized) { CleanUp(); }
+	SDLFrameSink *sink = new SDLFrameSink;
+	if (!sink->Init(p_width, p_height, p_fullscreen)) {
+		delete sink;
+		return false;
+	}
+	m_ownedSink = sink;
+	return Init(sink);
+}
+
+bool Renderer::InitHeadless(int p_width, int p_height)
+{
+	if (m_initialized) { CleanUp(); }
+	BufferFrameSink *sink = new BufferFrameSink;
+	if (!sink->Init(p_width, p_height)) {
+		delete sink;
+		return false;
+	}
+	m_ownedSink = sink;
+	return Init(sink);
+}
+
+bool Renderer::Init(FrameSink *p_sink)
+{
+	if (m_initialized && p_sink != m_ownedSink) { CleanUp(); }
+	if (p_sink == NULL || p_sink->GetWidth() <= 0 || p_sink->GetHeight() <= 0) { return false; }
+	m_sink = p_sink;
+	m_width = p_sink->GetWidth();
+	m_height = p_sink->GetHeight();
+	m_frame.Resize(m_width * m_height);
+	InitBuffers(m_width, m_height);
+	PrepareArenas();
+	m_frameCurrent = false;
+	m_initialized = true;
+	return m_initialized;
+}
+
+void Renderer::CleanUp( void )
+{
+	if (m_locked) { Refresh(); }
+	m_hitIds.Free();
+	m_tileIdCounts.Free();
+	m_columnDirections.Free();
+	m_rowSteps.Free();
+	m_depth.Free();
+	m_rayNear.Free();
+	m_rayFar.Free();
+	m_tileDepth.Free();
+	m_tileStart.Free();
+	m_tileOrder.Free();
+	m_frame.Free();
+	m_accumulators.Free();
+	m_giPending = 0;
+	m_refined.Free();
+	m_tileLevels.Free();
+	m_tileErrors.Free();
+	m_refinePending = 0;
+	m_frameCurrent = false;
+	delete [] m_arenas;
+	m_arenas = NULL;
+	m_arenaCount = 0;
+	m_threadCounters.Free();
+	ReleaseReplicas();
+	m_skipHistory = false;
+	m_tilesX = m_tilesY = 0;
+	if (m_ownedSink != NULL) {
+		delete m_ownedSink;
+		m_ownedSink = NULL;
+	}
+	m_sink = NULL;
+	m_color = NULL;
+	m_width = 0;
+	m_height = 0;
+	m_initialized = false;
+}
+
+void Renderer::LockFrame( void ) const
+{
+	// render straight into the sink's memory when it has any to give
+	if (!m_locked) {
+		m_color = m_sink->Lock();
+		if (m_color == NULL) { m_color = m_frame.GetData(); }
+		m_locked = true;
+	}
+}
+
+void Renderer::PrepareArenas( void ) const
+{
+	// the thread count only changes between frames
+	const int count = GetThreadCount();
+	if (count != m_arenaCount) {
+		delete [] m_arenas;
+		m_arenas = new FrameArena[count];
+		m_arenaCount = count;
+		m_threadCounters.Resize(count);
+	}
+	if (!m_placedCpus.IsEmpty() && m_threadNodes.GetSize() != count) {
+		PinThreads(); // placed threads, but not the ones there are now
+	}
+}
+
+void Renderer::ResetArenas( void ) const
+{
+	for (int i = 0; i < m_arenaCount; ++i) {
+		m_arenas[i].Reset();
+	}
+}
+
+FrameArena &Renderer::GetThreadArena( void ) const
+{
+	return m_arenas[GetThreadIndex()];
+}
+
+void Renderer::BeginCounters( void ) const
+{
+	if (!m_instrumented) { return; }
+	memset(&m_counters, 0, sizeof(m_counters));
+	m_counters.events.Clear();
+	for (int i = 0; i < m_threadCounters.GetSize(); ++i) {
+		m_threadCounters[i].rays = 0;
+	}
+	if (m_perfEnabled) {
+		// the counters count the thread that opened them, a new team size may bring new threads
+		if (m_perfCounters.GetSize() != GetThreadCount()) {
+			OpenPerfCounters();
+		}
+#pragma omp parallel
+		{
+			m_perfCounters[GetThreadIndex()]->Start();
+		}
+	}
+}
+
+void Renderer::CountRays(int p_count) const
+{
+	if (m_instrumented) {
+		m_threadCounters[GetThreadIndex()].rays += p_count;
+	}
+}
+
+void Renderer::EndCounters( void ) const
+{
+	if (!m_instrumented) { return; }
+	m_counters.threads = m_threadCounters.GetSize();
+	m_counters.busiestThread = 0;
+	m_counters.idlestThread = (m_counters.threads > 0) ? m_threadCounters[0].rays : 0;
+	for (int i = 0; i < m_threadCounters.GetSize(); ++i) {
+		const int rays = m_threadCounters[i].rays;
+		m_counters.rays += rays;
+		m_counters.busiestThread = Max2(m_counters.busiestThread, rays);
+		m_counters.idlestThread = Min2(m_counters.idlestThread, rays);
+	}
+	if (m_perfEnabled && m_perfCounters.GetSize() == GetThreadCount()) {
+#pragma omp parallel
+		{
+			m_perfCounters[GetThreadIndex()]->Stop(m_threadEvents[GetThreadIndex()]);
+		}
+		for (int i = 0; i < m_threadEvents.GetSize(); ++i) {
+			m_counters.events.Add(m_threadEvents[i]);
+		}
+		m_counters.threadEvents = m_threadEvents.GetData();
+	}
+}
+
+bool Renderer::OpenPerfCounters( void ) const
+{
+	ClosePerfCounters();
+	const int count = GetThreadCount();
+	for (int i = 0; i < count; ++i) {
+		m_perfCounters.PushBack(new PerfCounters);
+	}
+	m_threadEvents.Resize(count);
+	for (int i = 0; i < count; ++i) {
+		m_threadEvents[i].Clear();
+	}
+	int opened = 0;
+#pragma omp parallel reduction(+:opened)
+	{
+		if (m_perfCounters[GetThreadIndex()]->Open()) { ++opened; }
+	}
+	return opened > 0;
+}
+
+void Renderer::ClosePerfCounters( void ) const
+{
+	for (int i = 0; i < m_perfCounters.GetSize(); ++i) {
+		delete m_perfCounters[i];
+	}
+	m_perfCounters.Clear();
+	m_threadEvents.Clear();
+}
+
+void Renderer::RememberFrame(const Camera &camera, const Voxel *volume, const int dim) const
+{
+	m_framePosition = camera.GetPosition();
+	for (int i = 0; i < 4; ++i) {
+		m_framePorts[i] = camera.GetPortVector(i);
+	}
+	m_frameVolume = volume;
+	m_frameDim = dim;
+	m_frameGeneration = m_volumeGeneration;
+	m_frameLight = m_light;
+	m_frameLightGeneration = (m_light != NULL) ? m_light->GetGeneration() : 0;
+	m_frameOpacity = m_opacity;
+	m_frameCurrent = true;
+}
+
+void Renderer::TracePath(const Ray &ray, const Voxel *volume, const int dim, Uint32 &random, float *radiance) const
+{
+	radiance[0] = radiance[1] = radiance[2] = 0.f;
+	CollisionInfo collisionInfo = GetIntersection(ray, volume, dim);
+	if (collisionInfo.index < 0) { return; } // the background stays black, like in Shade
+
+	float throughput[3] = { 1.f, 1.f, 1.f };
+	Ray path = ray;
+	for (int bounce = 0; ; ++bounce) {
+		for (int i = 0; i < 3; ++i) {
+			throughput[i] *= collisionInfo.voxel.rgb[i] * (1.f / 255.f);
+		}
+		if (bounce == GIMaxBounces) { return; }
+
+		// leave the face that was hit in a cosine weighted direction about its normal
+		const int axis = collisionInfo.side;
+		const float normal = (path.direction[axis] < 0.f) ? 1.f : -1.f;
+		Ray next;
+		next.origin = path.origin + path.direction * (collisionInfo.distance / path.direction.Len());
+		next.origin[axis] += normal * GIBounceOffset;
+		const float u = NextRandom(random);
+		const float phi = NextRandom(random) * RAD_MAX;
+		const float r = sqrt(u);
+		next.direction[axis] = normal * sqrt(1.f - u);
+		next.direction[(axis + 1) % 3] = r * cos(phi);
+		next.direction[(axis + 2) % 3] = r * sin(phi);
+		for (int i = 0; i < 3; ++i) {
+			if (next.direction[i] == 0.f) { next.direction[i] = 1e-6f; } // traversal divides by every component
+		}
+
+		// a bounce that starts outside the volume has escaped to the sky, one that starts in a solid voxel
+		// (grazing an edge) is taken as blocked
+		bool inside = true;
+		int map[3];
+		for (int i = 0; i < 3; ++i) {
+			map[i] = int( next.origin[i] );
+			inside = inside && next.origin[i] >= 0.f && map[i] < dim;
+		}
+		if (inside) {
+			if (!volume[GetVoxelIndex<0>(map, dim)].isEmpty) { return; }
+			collisionInfo = GetIntersection(next, volume, dim);
+		}
+		if (!inside || collisionInfo.index < 0) {
+			for (int i = 0; i < 3; ++i) {
+				radiance[i] = throughput[i] * GISkyRadiance;
+			}
+			return;
+		}
+		path = next;
+	}
+}
+
+void Renderer::Accumulate(const Frustum &frustum, const Camera &camera, const Voxel *volume, const int dim) const
+{
+	const int pixelCount = m_width * m_height;
+	if (!IsSameView(camera, volume, dim) || m_accumulators.GetSize() != pixelCount) {
+		m_accumulators.Resize(pixelCount);
+		for (int i = 0; i < pixelCount; ++i) {
+			PixelAccumulator &accumulator = m_accumulators[i];
+			accumulator.sum[0] = accumulator.sum[1] = accumulator.sum[2] = 0.f;
+			accumulator.mean = accumulator.m2 = 0.f;
+			accumulator.samples = 0;
+			accumulator.converged = false;
+		}
+		m_giPending = pixelCount;
+	}
+	m_skipHistory = false;
+
+	// the frame's budget of samples is spread over the pixels that have not converged, so frames take
+	// about as long as the first one while the work left shrinks
+	FrameArena &arena = GetThreadArena();
+	int *pending = arena.Allocate<int>(m_giPending);
+	int pendingCount = 0;
+	for (int i = 0; i < pixelCount && pendingCount < m_giPending; ++i) {
+		if (!m_accumulators[i].converged) {
+			pending[pendingCount++] = i;
+		}
+	}
+	const int samples = (pendingCount > 0) ? Min2(Max2(int( (long long)m_giSamples * pixelCount / pendingCount ), m_giSamples), (int)GIMaxSamplesPerFrame) : 0;
+
+	int converged = 0;
+#pragma omp parallel for schedule(dynamic, 64) reduction(+:converged)
+	for (int p = 0; p < pendingCount; ++p) {
+		const int index = pending[p];
+		const int x = index % m_width;
+		const int y = index / m_width;
+		PixelAccumulator &accumulator = m_accumulators[index];
+		const Voxel *voxels = GetThreadVolume(volume);
+		Ray ray;
+		ray.origin = camera.GetPosition();
+		int s = 0;
+		for (; s < samples && !accumulator.converged; ++s) {
+			Uint32 random = HashUint(Uint32( index ) * 0x9e3779b9u ^ HashUint(Uint32( accumulator.samples )));
+			ray.direction = frustum.GetDirection(x + NextRandom(random), y + NextRandom(random));
+			float radiance[3];
+			TracePath(ray, voxels, dim, random, radiance);
+
+			accumulator.sum[0] += radiance[0];
+			accumulator.sum[1] += radiance[1];
+			accumulator.sum[2] += radiance[2];
+			const int n = ++accumulator.samples;
+			const float luminance = (radiance[0] + radiance[1] + radiance[2]) * (1.f / 3.f);
+			const float delta = luminance - accumulator.mean;
+			accumulator.mean += delta / n;
+			accumulator.m2 += delta * (luminance - accumulator.mean);
+			// the variance of the mean is m2 / (n - 1) / n
+			if (n >= GIMinSamples && (n >= GIMaxSamples || accumulator.m2 < GIConvergedError * GIConvergedError * n * (n - 1))) {
+				accumulator.converged = true;
+				++converged;
+			}
+		}
+		CountRays(s);
+	}
+	m_giPending -= converged;
+
+	// every pixel is written, the sink may hand out different memory each frame
+#pragma omp parallel for
+	for (int y = 0; y < m_height; ++y) {
+		const PixelAccumulator *accumulator = m_accumulators.GetData() + y * m_width;
+		pixel_t *pixel = m_color + y * m_width;
+		for (int x = 0; x < m_width; ++x) {
+			const float scale = (accumulator[x].samples > 0) ? 255.f / accumulator[x].samples : 0.f;
+			const int rgb[3] = {
+				Min2(int( accumulator[x].sum[0] * scale + 0.5f ), 255),
+				Min2(int( accumulator[x].sum[1] * scale + 0.5f ), 255),
+				Min2(int( accumulator[x].sum[2] * scale + 0.5f ), 255)
+			};
+			pixel[x] = PackPixel(rgb);
+		}
+	}
+}
+
+int Renderer::CompareRefineJobs(const void *a, const void *b)
+{
+	const RefineJob &l = *(const RefineJob*)a;
+	const RefineJob &r = *(const RefineJob*)b;
+	if (l.priority != r.priority) { return r.priority - l.priority; }
+	return l.tile - r.tile;
+}
+
+bool Renderer::RefineTile(const Camera &camera, const Voxel *volume, const int dim, int p_tile, int p_shift, double deadline) const
+{
+	const int x0 = (p_tile % m_tilesX) * TileSize;
+	const int y0 = (p_tile / m_tilesX) * TileSize;
+	const int x1 = Min2(x0 + (int)TileSize, m_width);
+	const int y1 = Min2(y0 + (int)TileSize, m_height);
+	const int size = 1 << p_shift;
+	const int coarser = (size << 1) - 1;
+
+	// the samples of the level before are kept, every other sample is traced and fills its block; a tile left
+	// when time is up stays at its level, the samples it got are only traced again
+	int traced = 0;
+	for (int y = y0; y < y1; y += size) {
+		for (int x = x0; x < x1; x += size) {
+			if (p_shift == CoarseShift || ((x | y) & coarser) != 0) {
+				if ((traced++ & (DeadlineRays - 1)) == 0 && GetTimeMs() >= deadline) { return false; }
+				TracePixel(camera, volume, dim, x, y);
+			}
+			const int sample = y * m_width + x;
+			const int blockX1 = Min2(x + size, x1);
+			for (int by = y; by < Min2(y + size, y1); ++by) {
+				FillPixels(m_color + by * m_width + x, blockX1 - x, m_color[sample]);
+				for (int bx = x; bx < blockX1; ++bx) {
+					const int index = by * m_width + bx;
+					if (index == sample) { continue; }
+					m_hitIds[index] = m_hitIds[sample];
+					m_depth[index] = 0.f; // the block may hide closer hits, temporal skipping must not start past them
+				}
+			}
+		}
+	}
+	m_tileLevels[p_tile] = p_shift;
+	return true;
+}
+
+int Renderer::GetTileError(int p_tile, int p_shift) const
+{
+	const int x0 = (p_tile % m_tilesX) * TileSize;
+	const int y0 = (p_tile / m_tilesX) * TileSize;
+	const int x1 = Min2(x0 + (int)TileSize, m_width);
+	const int y1 = Min2(y0 + (int)TileSize, m_height);
+	const int size = 1 << p_shift;
+
+	// samples that hit something else than the next sample to the right or below, which may be in the next tile
+	const unsigned int *ids = m_hitIds.GetData();
+	int error = 0;
+	for (int y = y0; y < y1; y += size) {
+		for (int x = x0; x < x1; x += size) {
+			const unsigned int id = ids[y * m_width + x];
+			if (x + size < m_width && ids[y * m_width + x + size] != id) { ++error; }
+			if (y + size < m_height && ids[(y + size) * m_width + x] != id) { ++error; }
+		}
+	}
+	return error;
+}
+
+void Renderer::FillUntraced( void ) const
+{
+	// tiles the coarse pass did not get to show the sample of a neighbouring tile, looked for to the left and
+	// above first and then to the right and below
+	const int tileCount = m_tilesX * m_tilesY;
+	int *sources = GetThreadArena().Allocate<int>(tileCount);
+	bool untraced = false;
+	for (int tile = 0; tile < tileCount; ++tile) {
+		sources[tile] = -1;
+		if (m_tileLevels[tile] != Untraced) {
+			sources[tile] = (tile / m_tilesX) * TileSize * m_width + (tile % m_tilesX) * TileSize;
+		} else {
+			untraced = true;
+		}
+	}
+	if (!untraced) { return; }
+	for (int tile = 0; tile < tileCount; ++tile) {
+		if (sources[tile] >= 0) { continue; }
+		if (tile % m_tilesX > 0 && sources[tile - 1] >= 0)			{ sources[tile] = sources[tile - 1]; }
+		else if (tile >= m_tilesX && sources[tile - m_tilesX] >= 0)	{ sources[tile] = sources[tile - m_tilesX]; }
+	}
+	for (int tile = tileCount - 1; tile >= 0; --tile) {
+		if (sources[tile] >= 0) { continue; }
+		if (tile % m_tilesX < m_tilesX - 1 && sources[tile + 1] >= 0)		{ sources[tile] = sources[tile + 1]; }
+		else if (tile + m_tilesX < tileCount && sources[tile + m_tilesX] >= 0)	{ sources[tile] = sources[tile + m_tilesX]; }
+	}
+
+	const int black[3] = { 0, 0, 0 };
+	for (int tile = 0; tile < tileCount; ++tile) {
+		if (m_tileLevels[tile] != Untraced) { continue; }
+		const int x0 = (tile % m_tilesX) * TileSize;
+		const int y0 = (tile / m_tilesX) * TileSize;
+		const pixel_t color = (sources[tile] >= 0) ? m_color[sources[tile]] : PackPixel(black);
+		const unsigned int id = (sources[tile] >= 0) ? m_hitIds[sources[tile]] : 0xffffffff;
+		const int x1 = Min2(x0 + (int)TileSize, m_width);
+		for (int y = y0; y < Min2(y0 + (int)TileSize, m_height); ++y) {
+			FillPixels(m_color + y * m_width + x0, x1 - x0, color);
+			for (int x = x0; x < x1; ++x) {
+				m_hitIds[y * m_width + x] = id;
+				m_depth[y * m_width + x] = 0.f;
+			}
+		}
+	}
+}
+
+void Renderer::RenderBudgeted(const Camera &camera, const Voxel *volume, const int dim, double deadline) const
+{
+	const int tileCount = m_tilesX * m_tilesY;
+	if (!IsSameView(camera, volume, dim) || m_tileLevels.GetSize() != tileCount) {
+		m_tileLevels.Resize(tileCount);
+		m_tileErrors.Resize(tileCount);
+		for (int tile = 0; tile < tileCount; ++tile) {
+			m_tileLevels[tile] = Untraced;
+			m_tileErrors[tile] = 0;
+		}
+	}
+
+	// the frame is built up in memory of its own, the sink may hand out different memory each frame
+	pixel_t *const target = m_color;
+	m_color = m_refined.GetData();
+
+	// coarse pass, tiles in a scattered order so that a pass that runs out of time still covers the screen;
+	// the deadline is checked every few rays, so a frame is late by at most that many rays per thread
+	FrameArena &arena = GetThreadArena();
+	int *order = arena.Allocate<int>(tileCount);
+	int step = Max2(int( tileCount * 0.618f ), 1);
+	while (Gcd(step, tileCount) != 1) { ++step; }
+	int coarseCount = 0;
+	for (int i = 0; i < tileCount; ++i) {
+		const int tile = int( (long long)i * step % tileCount );
+		if (m_tileLevels[tile] == Untraced) {
+			order[coarseCount++] = tile;
+		}
+	}
+#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < coarseCount; ++i) {
+		RefineTile(camera, GetThreadVolume(volume), dim, order[i], CoarseShift, deadline);
+	}
+	FillUntraced();
+	// errors read the neighbouring tiles, so they are taken once a round is done and no tile is being written
+	for (int i = 0; i < coarseCount; ++i) {
+		if (m_tileLevels[order[i]] == CoarseShift) {
+			m_tileErrors[order[i]] = GetTileError(order[i], CoarseShift);
+		}
+	}
+
+	// then rounds of refining the tiles that look worst by one level, a quarter of them (and enough to keep
+	// every thread busy) per round, so that the priorities follow what was traced; a tile's error is taken
+	// after the round that refined it and not updated as its neighbours are
+	RefineJob *jobs = arena.Allocate<RefineJob>(tileCount);
+	const int roundMin = GetThreadCount() * 4;
+	while (GetTimeMs() < deadline) {
+		int count = 0;
+		for (int tile = 0; tile < tileCount; ++tile) {
+			const int level = m_tileLevels[tile];
+			if (level > 0 && level != Untraced) {
+				jobs[count].tile = tile;
+				jobs[count].level = level;
+				jobs[count].priority = (1 + m_tileErrors[tile]) << (2 * level);
+				++count;
+			}
+		}
+		if (count == 0) { break; }
+		qsort(jobs, count, sizeof(RefineJob), CompareRefineJobs);
+		const int roundSize = Min2(Max2(count / 4, roundMin), count);
+#pragma omp parallel for schedule(dynamic)
+		for (int i = 0; i < roundSize; ++i) {
+			RefineTile(camera, GetThreadVolume(volume), dim, jobs[i].tile, jobs[i].level - 1, deadline);
+		}
+		for (int i = 0; i < roundSize; ++i) {
+			if (m_tileLevels[jobs[i].tile] != jobs[i].level) {
+				m_tileErrors[jobs[i].tile] = GetTileError(jobs[i].tile, m_tileLevels[jobs[i].tile]);
+			}
+		}
+	}
+
+	m_refinePending = 0;
+	for (int tile = 0; tile < tileCount; ++tile) {
+		if (m_tileLevels[tile] != 0) { ++m_refinePending; }
+	}
+	m_color = target;
+	memcpy(m_color, m_refined.GetData(), sizeof(pixel_t) * m_width * m_height);
+}
+
+void Renderer::RenderRows(const Frustum &frustum, const Camera &camera, const Voxel *volume, const int dim, int x0, int y0, int x1, int y1) const
+{
+	// statically scheduled, so every thread gets one band of rows, and placed threads of a node neighbouring bands
+#pragma omp parallel for
+	for (int y = y0; y < y1; ++y) {
+		const Voxel *voxels = GetThreadVolume(volume);
+
+		vec3_t normalXDelta;
+		Ray ray;
+		ray.origin = camera.GetPosition();
+		frustum.GetRow(y, ray.direction, normalXDelta);
+		pixel_t *pixel = m_color + m_width * y + x0;
+		unsigned int *id = m_hitIds.GetData() + m_width * y + x0;
+		float *depth = m_depth.GetData() + m_width * y + x0;
+
+		// directions are stepped from the left edge even when starting further in, so that
+		// every pixel gets the same ray no matter how the screen is split up
+		for (int x = 0; x < x0; ++x) {
+			ray.direction += normalXDelta;
+		}
+		CountRays(x1 - x0);
+
+		for(int x = x0; x < x1; ++x) {
+
+			CollisionInfo collisionInfo = GetPrimaryIntersection(ray, x, y, voxels, dim);
+
+			// draw pixel on screen
+			int rgb[3];
+			ShadeHit(ray, collisionInfo, voxels, dim, rgb);
+			*pixel = PackPixel(rgb);
+			*id = GetHitId(collisionInfo);
+			*depth = collisionInfo.distance;
+
+			// interpolate x
+			ray.direction += normalXDelta;
+
+			// step to next pixel
+			++pixel;
+			++id;
+			++depth;
+		}
+	}
+}
+
+void Renderer::RenderTiles(const Camera &camera, const Voxel *volume, const int dim, const TileJob *jobs, int count) const
+{
+	if (m_nodeCount <= 1) {
+#pragma omp parallel for schedule(dynamic)
+		for (int tile = 0; tile < count; ++tile) {
+			RenderTile(camera, GetThreadVolume(volume), dim, jobs[tile].x, jobs[tile].y, jobs[tile].rate);
+		}
+		return;
+	}
+
+	// every node gets a band of tile rows as tall as its share of the threads, so that the threads of a node
+	// trace neighbouring pixels, whose rays mostly read the same parts of the volume; a node that is done
+	// helps the others
+	FrameArena &arena = GetThreadArena();
+	int *bandEnd = arena.Allocate<int>(m_nodeCount);
+	for (int node = 0, threads = 0; node < m_nodeCount; ++node) {
+		for (int t = 0; t < m_threadNodes.GetSize(); ++t) {
+			if (m_threadNodes[t] == node) { ++threads; }
+		}
+		bandEnd[node] = m_tilesY * threads / m_threadNodes.GetSize();
+	}
+	int *start = arena.Allocate<int>(m_nodeCount + 1);
+	int *next = arena.Allocate<int>(m_nodeCount);
+	TileJob *byNode = arena.Allocate<TileJob>(count);
+	int *nodes = arena.Allocate<int>(count);
+	for (int node = 0; node <= m_nodeCount; ++node) {
+		start[node] = 0;
+	}
+	for (int tile = 0; tile < count; ++tile) {
+		int node = 0;
+		while (node < m_nodeCount - 1 && jobs[tile].y >= bandEnd[node]) { ++node; }
+		nodes[tile] = node;
+		++start[node + 1];
+	}
+	for (int node = 0; node < m_nodeCount; ++node) {
+		start[node + 1] += start[node];
+		next[node] = start[node];
+	}
+	for (int tile = 0; tile < count; ++tile) {
+		byNode[next[nodes[tile]]++] = jobs[tile]; // keeps the order of jobs within a node
+	}
+	for (int node = 0; node < m_nodeCount; ++node) {
+		next[node] = 0;
+	}
+
+#pragma omp parallel
+	{
+		const int thread = GetThreadIndex();
+		const int home = (thread < m_threadNodes.GetSize()) ? m_threadNodes[thread] : 0;
+		const Voxel *voxels = GetThreadVolume(volume);
+		for (int n = 0; n < m_nodeCount; ++n) {
+			const int node = (home + n) % m_nodeCount;
+			while (true) {
+				int tile;
+#pragma omp atomic capture
+				tile = next[node]++;
+				tile += start[node];
+				if (tile >= start[node + 1]) { break; }
+				RenderTile(camera, voxels, dim, byNode[tile].x, byNode[tile].y, byNode[tile].rate);
+			}
+		}
+	}
+}
+
+void Renderer::PrepareReplicas(const Voxel *volume, const int dim) const
+{
+	if (!m_replicate || m_nodeCount <= 1) {
+		ReleaseReplicas();
+		return;
+	}
+	if (volume == m_replicaSource && dim == m_replicaDim && m_volumeGeneration == m_replicaGeneration) { return; }
+
+	// a volume that does not fit once per node is read from where it is
+	ReleaseReplicas();
+	m_replicaSource = volume;
+	m_replicaDim = dim;
+	m_replicaGeneration = m_volumeGeneration;
+	for (int node = 0; node < m_nodeCount; ++node) {
+		m_replicas.PushBack(new VolumeMemory);
+		if (!m_replicas[node]->Reserve(dim)) {
+			ReleaseReplicas();
+			return;
+		}
+	}
+
+	// the threads of a node copy its replica, so that the pages are placed on the node
+	VolumeMemory *const *replicas = m_replicas.GetData();
+	const size_t plane = (size_t)dim * dim;
+#pragma omp parallel
+	{
+		const int thread = GetThreadIndex();
+		const int team = Min2(GetTeamSize(), m_threadNodes.GetSize());
+		if (thread < team) {
+			const int node = m_threadNodes[thread];
+			int rank = 0, threads = 0;
+			for (int t = 0; t < team; ++t) {
+				if (m_threadNodes[t] == node) {
+					if (t < thread) { ++rank; }
+					++threads;
+				}
+			}
+			Voxel *replica = replicas[node]->GetVoxels();
+			for (int z = rank; z < dim; z += threads) {
+				memcpy(replica + z * plane, volume + z * plane, plane * sizeof(Voxel));
+			}
+		}
+	}
+}
+
+void Renderer::ReleaseReplicas( void ) const
+{
+	for (int node = 0; node < m_replicas.GetSize(); ++node) {
+		delete m_replicas[node];
+	}
+	m_replicas.Free();
+}
+
+const Voxel *Renderer::GetThreadVolume(const Voxel *volume) const
+{
+	if (volume != m_replicaSource || m_replicas.GetSize() == 0) { return volume; }
+	const int thread = GetThreadIndex();
+	return (thread < m_threadNodes.GetSize()) ? m_replicas[m_threadNodes[thread]]->GetVoxels() : volume;
+}
+
+void Renderer::Render(const Camera &camera, const Voxel *volume, const int dim) const
+{
+	// NOTE: Will not render rays originating from outside a volume correctly. May crash.
+
+	const double start = GetTimeMs();
+	LockFrame();
+	PrepareArenas();
+	PrepareReplicas(volume, dim);
+	BeginCounters();
+	const Frustum frustum = GetFrustum(camera);
+	m_kernels = SelectKernels(m_traversal, dim);
+	m_lightActive = m_light != NULL && m_light->IsBuiltFor(volume, dim);
+	if (m_giSamples > 0) {
+		Accumulate(frustum, camera, volume, dim);
+		EndCounters();
+		ResetArenas();
+		RememberFrame(camera, volume, dim);
+		return;
+	}
+	PrepareSkip(camera, frustum);
+	if (m_splatting) {
+		Splat(camera, frustum, volume, dim);
+	}
+
+	if (m_timeBudget > 0.f || m_vrsMode != VRS_OFF || m_order != ORDER_ROWS) {
+		PrepareColumnDirections(frustum); // for pixels traced out of row order
+	}
+	if (m_timeBudget > 0.f) {
+		RenderBudgeted(camera, volume, dim, start + m_timeBudget);
+	} else if (m_vrsMode != VRS_OFF) {
+		// full rate tiles are handed out first, so that threads finish on cheap tiles
+		const int tileCount = m_tilesX * m_tilesY;
+		TileJob *jobs = GetThreadArena().Allocate<TileJob>(tileCount);
+		int rateCounts[3] = { 0, 0, 0 };
+		for (int tile = 0; tile < tileCount; ++tile) {
+			jobs[tile].x = m_tileOrder[tile] % m_tilesX;
+			jobs[tile].y = m_tileOrder[tile] / m_tilesX;
+			jobs[tile].rate = GetTileRate(jobs[tile].x, jobs[tile].y);
+			++rateCounts[jobs[tile].rate];
+		}
+		TileJob *sorted = GetThreadArena().Allocate<TileJob>(tileCount);
+		int rateStart[3] = { 0, rateCounts[RATE_FULL], rateCounts[RATE_FULL] + rateCounts[RATE_HALF] };
+		for (int tile = 0; tile < tileCount; ++tile) {
+			sorted[rateStart[jobs[tile].rate]++] = jobs[tile];
+		}
+		if (m_instrumented) {
+			memcpy(m_counters.tiles, rateCounts, sizeof(rateCounts));
+		}
+
+		RenderTiles(camera, volume, dim, sorted, tileCount);
+	} else if (m_order != ORDER_ROWS) {
+		const int tileCount = m_tilesX * m_tilesY;
+		TileJob *jobs = GetThreadArena().Allocate<TileJob>(tileCount);
+		for (int tile = 0; tile < tileCount; ++tile) {
+			jobs[tile].x = m_tileOrder[tile] % m_tilesX;
+			jobs[tile].y = m_tileOrder[tile] / m_tilesX;
+			jobs[tile].rate = RATE_FULL;
+		}
+		RenderTiles(camera, volume, dim, jobs, tileCount);
+	} else {
+		RenderRows(frustum, camera, volume, dim, 0, 0, m_width, m_height);
+	}
+
+	UpdateSkip(camera, frustum);
+	if (m_aaSamples > 1 && m_timeBudget <= 0.f) {
+		AntiAlias(frustum, camera, volume, dim);
+	}
+	EndCounters();
+	ResetArenas();
+	RememberFrame(camera, volume, dim);
+}
+
+void Renderer::RenderRegion(const Camera &camera, const Voxel *volume, const int dim, int x0, int y0, int x1, int y1) const
+{
+	LockFrame();
+	PrepareArenas();
+	PrepareReplicas(volume, dim);
+	BeginCounters();
+	const Frustum frustum = GetFrustum(camera);
+	m_kernels = SelectKernels(m_traversal, dim);
+	m_lightActive = m_light != NULL && m_light->IsBuiltFor(volume, dim);
+	m_skipHistory = false; // neighbouring frames may have covered other parts of the screen
+	PrepareSkip(camera, frustum);
+	if (m_splatting) {
+		Splat(camera, frustum, volume, dim);
+	}
+	RenderRows(frustum, camera, volume, dim, Max2(x0, 0), Max2(y0, 0), Min2(x1, m_width), Min2(y1, m_height));
+	EndCounters();
+	ResetArenas();
+	m_frameCurrent = false; // only part of the screen was rendered
+}
+
+void Renderer::Refresh( void ) const
+{
+	if (m_locked) {
+		m_sink->Unlock(m_color);
+		m_locked = false;
+	}
+}
+
+void Renderer::SetAntiAliasing(int p_samples, AntiAliasPattern p_pattern)
+{
+	m_frameCurrent = false;
+	m_aaSamples = (p_samples > MaxAASamples) ? (int)MaxAASamples : p_samples;
+	if (m_aaSamples <= 1) {
+		m_aaSamples = 0;
+		return;
+	}
+
+	// sample offsets are relative to the pixel's primary ray at (0,0) and cover [0,1) in x and y
+	int gridDim = 1;
+	while (gridDim * gridDim < m_aaSamples) { ++gridDim; }
+	int rookStride = gridDim; // must be coprime with the sample count so that every row is used once
+	while (Gcd(rookStride, m_aaSamples) != 1) { ++rookStride; }
+	for (int i = 0; i < m_aaSamples; ++i) {
+		switch (p_pattern) {
+		case AA_GRID:
+			m_aaOffsets[i][0] = ((i % gridDim) + 0.5f) / gridDim;
+			m_aaOffsets[i][1] = ((i / gridDim) + 0.5f) / gridDim;
+			break;
+		case AA_ROTATED_GRID:
+			m_aaOffsets[i][0] = (i + 0.5f) / m_aaSamples;
+			m_aaOffsets[i][1] = (((i * rookStride) % m_aaSamples) + 0.5f) / m_aaSamples;
+			break;
+		case AA_HALTON:
+		default:
+			{
+				// radical inverse of i+1 in base 2 and 3
+				float inv2 = 0.5f, inv3 = 1.f / 3.f;
+				m_aaOffsets[i][0] = m_aaOffsets[i][1] = 0.f;
+				for (int n = i + 1; n > 0; n /= 2, inv2 *= 0.5f)		{ m_aaOffsets[i][0] += (n % 2) * inv2; }
+				for (int n = i + 1; n > 0; n /= 3, inv3 *= 1.f / 3.f)	{ m_aaOffsets[i][1] += (n % 3) * inv3; }
+			}
+			break;
+		}
+	}
+}
+
+void Renderer::SetVariableRate(VariableRateMode p_mode)
+{
+	m_vrsMode = p_mode;
+	m_frameCurrent = false;
+	for (int i = 0; i < m_tileIdCounts.GetSize(); ++i) {
+		m_tileIdCounts[i] = 3;
+	}
+}
+
+void Renderer::SetFocus(float p_x, float p_y, float p_fullRadius, float p_halfRadius)
+{
+	m_focus[0] = p_x;
+	m_focus[1] = p_y;
+	m_fullRadius = p_fullRadius;
+	m_halfRadius = p_halfRadius;
+	m_frameCurrent = false;
+}
+
+void Renderer::SetScreenOrder(ScreenOrder p_order)
+{
+	m_order = p_order;
+	m_frameCurrent = false;
+	UpdateOrders();
+}
+
+void Renderer::SetTraversal(TraversalMode p_mode)
+{
+	m_traversal = p_mode;
+	m_frameCurrent = false;
+}
+
+void Renderer::SetTemporalSkip(bool p_enabled)
+{
+	m_temporalSkip = p_enabled;
+	m_skipHistory = false;
+	m_frameCurrent = false;
+}
+
+void Renderer::SetSplatting(bool p_enabled)
+{
+	m_splatting = p_enabled;
+	m_skipHistory = false;
+	m_frameCurrent = false;
+}
+
+void Renderer::InvalidateVolume( void )
+{
+	m_bricks.Invalidate();
+	m_skipHistory = false;
+	++m_volumeGeneration;
+}
+
+bool Renderer::IsSameView(const Camera &camera, const Voxel *volume, const int dim) const
+{
+	if (!m_frameCurrent || volume != m_frameVolume || dim != m_frameDim || m_volumeGeneration != m_frameGeneration) { return false; }
+	if (m_light != m_frameLight || (m_light != NULL && m_light->GetGeneration() != m_frameLightGeneration)) { return false; }
+	if (m_opacity != m_frameOpacity) { return false; }
+	if (!(camera.GetPosition() == m_framePosition)) { return false; }
+	for (int i = 0; i < 4; ++i) {
+		if (!(camera.GetPortVector(i) == m_framePorts[i])) { return false; }
+	}
+	return true;
+}
+
+bool Renderer::IsFrameCurrent(const Camera &camera, const Voxel *volume, const int dim) const
+{
+	if (!IsSameView(camera, volume, dim)) { return false; }
+	if (m_giSamples > 0) { return m_giPending == 0; }
+	return m_timeBudget <= 0.f || m_refinePending == 0;
+}
+
+void Renderer::InvalidateFrame( void )
+{
+	m_frameCurrent = false;
+}
+
+void Renderer::SetGlobalIllumination(int p_samples)
+{
+	m_giSamples = Max2(p_samples, 0);
+	m_frameCurrent = false;
+	m_skipHistory = false;
+	for (int i = 0; i < m_tileIdCounts.GetSize(); ++i) {
+		m_tileIdCounts[i] = 3;
+	}
+}
+
+void Renderer::SetLightVolume(const LightVolume *p_light)
+{
+	m_light = p_light;
+	m_frameCurrent = false;
+}
+
+void Renderer::SetOpacity(const byte_t *p_opacity)
+{
+	m_opacity = p_opacity;
+	m_frameCurrent = false;
+}
+
+int Renderer::GetUnconvergedCount( void ) const
+{
+	return (m_giSamples > 0) ? m_giPending : 0;
+}
+
+void Renderer::SetTimeBudget(float p_ms)
+{
+	m_timeBudget = Max2(p_ms, 0.f);
+	m_frameCurrent = false;
+}
+
+float Renderer::GetRefinement( void ) const
+{
+	const int tileCount = m_tilesX * m_tilesY;
+	if (m_timeBudget <= 0.f || tileCount == 0 || m_tileLevels.GetSize() != tileCount) { return 1.f; }
+	return 1.f - float( m_refinePending ) / tileCount;
+}
+
+bool Renderer::SetThreadPlacement(ThreadPlacement p_placement)
+{
+	ThreadTopology topology;
+	const bool placed = p_placement != PLACE_OFF && topology.Read((p_placement == PLACE_CORES) ? ThreadTopology::SMT_ONE_PER_CORE : ThreadTopology::SMT_ALL);
+	if (!placed && m_placement == PLACE_OFF) { return p_placement == PLACE_OFF; } // nothing was pinned
+
+	ReleaseReplicas();
+	m_replicaSource = NULL;
+	m_frameCurrent = false;
+#ifdef _OPENMP
+	// pins stay with the threads they were made on, so while placed the runtime may not resize teams, and is
+	// assumed to bring back the same threads for every region of the same size, as the common ones do; frames
+	// pin again when the thread count changes
+	static const int defaultThreads = omp_get_max_threads();
+	static const int defaultDynamic = omp_get_dynamic();
+	omp_set_num_threads(placed ? topology.GetCpuCount() : defaultThreads);
+	omp_set_dynamic(placed ? 0 : defaultDynamic);
+#endif
+	m_placedCpus.Clear();
+	for (int i = 0; placed && i < topology.GetCpuCount(); ++i) {
+		m_placedCpus.PushBack(topology.GetCpu(i));
+	}
+	PinThreads();
+	if (m_perfEnabled) {
+		OpenPerfCounters();
+	}
+	m_nodeCount = placed ? topology.GetNodeCount() : 1;
+	m_placement = placed ? p_placement : PLACE_OFF;
+	return placed == (p_placement != PLACE_OFF);
+}
+
+void Renderer::PinThreads( void ) const
+{
+	m_threadNodes.Clear();
+	for (int i = 0; !m_placedCpus.IsEmpty() && i < GetThreadCount(); ++i) {
+		m_threadNodes.PushBack(m_placedCpus[i % m_placedCpus.GetSize()].node);
+	}
+#pragma omp parallel
+	{
+		ThreadTopology::Pin(m_placedCpus.IsEmpty() ? -1 : m_placedCpus[GetThreadIndex() % m_placedCpus.GetSize()].id);
+	}
+}
+
+void Renderer::SetVolumeReplication(bool p_enabled)
+{
+	m_replicate = p_enabled;
+	if (!p_enabled) {
+		ReleaseReplicas();
+		m_replicaSource = NULL;
+	}
+}
+
+int Renderer::GetNodeCount( void ) const
+{
+	return m_nodeCount;
+}
+
+void Renderer::SetInstrumentation(bool p_enabled)
+{
+	m_instrumented = p_enabled;
+	memset(&m_counters, 0, sizeof(m_counters));
+	m_counters.events.Clear();
+}
+
+bool Renderer::IsInstrumented( void ) const
+{
+	return m_instrumented;
+}
+
+const Renderer::FrameCounters &Renderer::GetCounters( void ) const
+{
+	return m_counters;
+}
+
+bool Renderer::SetPerfCounters(bool p_enabled)
+{
+	ClosePerfCounters();
+	m_perfEnabled = p_enabled && OpenPerfCounters();
+	if (!m_perfEnabled) {
+		ClosePerfCounters();
+	}
+	return m_perfEnabled == p_enabled;
+}
+
+const pixel_t *Renderer::GetPixels( void ) const
+{
+	return m_color;
+}
+
+pixel_t *Renderer::GetFrame( void )
+{
+	return m_locked ? m_color : NULL;
+}
+
+int Renderer::GetWidth( void ) const
+{
+	return m_width;
+}
+
+int Renderer::GetHeight( void ) const
+{
+	return m_height;
+}
+
+int Renderer::GetArenaCount( void ) const
+{
+	return m_arenaCount;
+}
+
+const FrameArena &Renderer::GetArena(int p_thread) const
 {
-	SDL_Flip(SDL_GetVideoSurface());
+	return m_arenas[p_thread];
 }
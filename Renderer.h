@@ -1,25 +1,369 @@
 #ifndef RENDERER_H_INCLUDED__
 #define RENDERER_H_INCLUDED__
 
+#include <iostream>
+
 #include "mtlList.h"
+#include "mtlArray.h"
 #include "Voxel.h"
 #include "Camera.h"
 #include "Ray.h"
+#include "BrickMap.h"
+#include "FrameSink.h"
+#include "FrameArena.h"
+#include "LightVolume.h"
+#include "PerfCounters.h"
+#include "ThreadTopology.h"
+
+class VolumeMemory;
 
 class Renderer
 {
+public:
+	enum AntiAliasPattern
+	{
+		AA_GRID,			// regular n x n grid
+		AA_ROTATED_GRID,	// n-rooks, one sample per row and column
+		AA_HALTON			// Halton (2,3) sequence
+	};
+	enum { MaxAASamples = 16 };
+	enum VariableRateMode
+	{
+		VRS_OFF,		// one ray per pixel everywhere
+		VRS_FOCUS,		// ray density falls off with distance from the focus point
+		VRS_CONTENT		// tiles that were uniform last frame get fewer rays
+	};
+	enum { TileSize = 16 };
+	enum { SkipMargin = 2 }; // voxels kept in front of the previous frame's closest hit when skipping empty space
+	enum { MaxSkipRadius = 4 }; // tiles, skipping is off for a frame whose view shifted further than this
+	enum TraversalMode
+	{
+		TRAVERSE_FLOAT,	// float side distances
+		TRAVERSE_FIXED	// 64-bit fixed point side distances, no drift on long rays
+	};
+	// rays of CheckTraversal, counts per TraversalMode
+	struct TraversalCheck
+	{
+		int		rays;
+		int		edges;			// rays exactly through a voxel edge, where the lower axis is stepped first
+		int		differing[2];	// rays a mode resolved differently from the reference
+		double	maxError[2];	// largest distance error on the rays a mode resolved like the reference
+		double	length;			// summed distance to what the reference hit
+		int		reports;		// rays printed so far
+
+		void	Clear( void );
+		bool	Agrees( void ) const;
+		void	Print(std::ostream &p_out) const;
+	};
+	enum ScreenOrder
+	{
+		ORDER_ROWS,		// scanlines, a band of them per thread; tiles and their pixels in raster order
+		ORDER_MORTON,	// tiles, and pixels within them, along a Z-order curve
+		ORDER_HILBERT	// along a Hilbert curve, every step goes to a neighbour
+	};
+	enum ThreadPlacement
+	{
+		PLACE_OFF,		// render threads run wherever the system puts them
+		PLACE_CORES,	// a render thread pinned to every physical core, SMT siblings stay idle
+		PLACE_THREADS	// a render thread pinned to every hardware thread
+	};
+	enum { GIMaxBounces = 3 };			// diffuse bounces after the primary hit, a path that has not reached the sky by then gets no light
+	enum { GIMinSamples = 16 };			// a pixel is not taken as converged before it has this many samples
+	enum { GIMaxSamples = 4096 };		// or traced any more once it has this many
+	enum { GIMaxSamplesPerFrame = 256 };	// per pixel, the frame's sample budget goes to the pixels that are left
+	enum { CoarseShift = 4 };			// log2 of TileSize, a time budgeted frame starts with one ray per tile
+	// work done by the last Render or RenderRegion, only counted while instrumentation is on
+	struct FrameCounters
+	{
+		int		threads;
+		int		tiles[3];		// traced at full, half and quarter ray density, 0 unless variable rate is on
+		int		rays;			// primary rays, antialiasing samples and path samples
+		int		busiestThread;	// rays traced by the thread that traced the most
+		int		idlestThread;	// and by the one that traced the fewest
+		PerfCounters::Values		events;			// hardware events summed over the threads, -1 where not counted
+		const PerfCounters::Values	*threadEvents;	// per thread, NULL unless hardware counters are on
+	};
+private:
+	enum TileRate
+	{
+		RATE_FULL,		// every pixel
+		RATE_HALF,		// checkerboard
+		RATE_QUARTER	// one pixel per 2x2 block
+	};
+	struct TileJob
+	{
+		int			x, y;	// in tiles
+		TileRate	rate;
+	};
+	// running sums of a pixel's path traced samples
+	struct PixelAccumulator
+	{
+		float	sum[3];		// color24 order
+		float	mean, m2;	// of the samples' luminance, for the convergence test
+		int		samples;
+		bool	converged;
+	};
+	// a cache line each, so that counting threads do not share one
+	struct ThreadCounter
+	{
+		int		rays;
+		char	pad[64 - sizeof(int)];
+	};
+	// a tile waiting to be refined by a time budgeted frame
+	struct RefineJob
+	{
+		int		tile;
+		int		level;		// of the tile before the round
+		int		priority;	// pixels per traced sample, weighted by how many of the samples differ from their neighbours
+	};
+	enum { Untraced = CoarseShift + 1 }; // tile level before the coarse pass reached it
+	// screen rectangle of a brick's projection, inclusive
+	struct SplatRect
+	{
+		float	boxMin[3], boxMax[3];
+		int		x0, y0, x1, y1;
+	};
 private:
-	mutable byte_t	*m_color;
-	int				m_width, m_height;
-	bool			m_initialized;
+	// interpolates primary ray directions across the view port
+	struct Frustum
+	{
+		vec3_t	upperLeft, upperRight;
+		vec3_t	leftDelta, rightDelta;	// per scanline
+		float	invWidth;
+
+		vec3_t	GetDirection(float x, float y) const;
+		// the direction of a row's first pixel and the step to the next one; primary rays step along the row
+		// from there, so that every pixel gets the same ray whichever order it is traced in
+		void	GetRow(int y, vec3_t &first, vec3_t &step) const;
+	};
+private:
+	typedef CollisionInfo (*IntersectionKernel)(const Ray &ray, const Voxel *volume, const int dim);
+	// kernels for a volume dimension known at compile time (0 = any), one per ray direction octant
+	template < int Dim >
+	struct KernelTable
+	{
+		static const IntersectionKernel	Float[8];
+		static const IntersectionKernel	Fixed[8];
+		static const IntersectionKernel	*Get(TraversalMode p_mode);
+	};
+private:
+	mutable pixel_t					*m_color;	// frame being rendered, valid from Render until Refresh
+	FrameSink						*m_sink;
+	FrameSink						*m_ownedSink;	// created by Init or InitHeadless
+	mutable mtl::Array<pixel_t>		m_frame;	// rendered into when the sink has no memory to give
+	mutable bool					m_locked;
+	mutable mtl::Array<unsigned int>	m_hitIds;	// per pixel, see GetHitId
+	int								m_width, m_height;
+	bool							m_initialized;
+	int								m_aaSamples;
+	vec2_t							m_aaOffsets[MaxAASamples];
+	VariableRateMode				m_vrsMode;
+	vec2_t							m_focus;		// normalized screen coordinates
+	float							m_fullRadius;	// in units of screen height
+	float							m_halfRadius;
+	int								m_tilesX, m_tilesY;
+	mutable mtl::Array<vec3_t>		m_columnDirections;	// primary ray direction of every row's first pixel in each tile column
+	mutable mtl::Array<vec3_t>		m_rowSteps;			// change of the primary ray direction from one pixel of a row to the next
+	mutable mtl::Array<int>			m_tileIdCounts;	// distinct hit ids in each tile last frame, saturates at 3
+	TraversalMode					m_traversal;
+	ScreenOrder						m_order;
+	mtl::Array<int>					m_tileOrder;	// tile indices in the order they are handed out
+	int								m_pixelOrder[TileSize * TileSize];	// y * TileSize + x within a tile, in tracing order
+	mutable const IntersectionKernel	*m_kernels;	// selected per frame by SelectKernels
+	mutable mtl::Array<float>		m_depth;		// per pixel, CollisionInfo::distance of the primary ray
+	bool							m_temporalSkip;
+	mutable bool					m_skipHistory;	// m_tileDepth and the previous camera are valid
+	mutable mtl::Array<float>		m_tileDepth;	// closest primary hit (or volume exit) per tile last frame
+	mutable mtl::Array<float>		m_tileStart;	// distance primary rays start at this frame
+	mutable vec3_t					m_prevPosition;
+	mutable vec3_t					m_prevDirection;
+	mutable vec3_t					m_prevPlanes[4];	// side planes of the previous view frustum, normals inward
+	bool							m_splatting;
+	mutable BrickMap				m_bricks;	// rebuilt when Render is handed a different volume
+	mutable mtl::Array<float>		m_rayNear;	// per pixel distance interval that holds every occupied brick along the primary ray,
+	mutable mtl::Array<float>		m_rayFar;	// empty (near > far) when there are none
+	unsigned int					m_volumeGeneration;	// bumped by InvalidateVolume
+	mutable bool					m_frameCurrent;	// nothing that went into the last frame changed since, see IsFrameCurrent
+	mutable vec3_t					m_framePosition;
+	mutable vec3_t					m_framePorts[4];
+	mutable const Voxel				*m_frameVolume;
+	mutable int						m_frameDim;
+	mutable unsigned int			m_frameGeneration;
+	const LightVolume				*m_light;
+	mutable bool					m_lightActive;	// m_light belongs to the volume being rendered
+	int								m_lightBrightness[LightVolume::MaxLevel + 1];	// 256 = full
+	mutable const LightVolume		*m_frameLight;
+	mutable unsigned int			m_frameLightGeneration;
+	const byte_t					*m_opacity;	// per voxel, NULL when every solid voxel is opaque
+	mutable const byte_t			*m_frameOpacity;
+	int								m_giSamples;	// per pixel and frame, 0 when global illumination is off
+	mutable mtl::Array<PixelAccumulator>	m_accumulators;
+	mutable int						m_giPending;	// pixels that have not converged
+	float							m_timeBudget;	// ms per Render, 0 when frames are traced in full
+	mutable mtl::Array<pixel_t>		m_refined;		// the frame time budgeted Renders build up over several calls
+	mutable mtl::Array<int>			m_tileLevels;	// log2 of the spacing of a tile's traced samples, Untraced before the coarse pass
+	mutable mtl::Array<int>			m_tileErrors;	// GetTileError at a tile's level when it was reached
+	mutable int						m_refinePending;	// tiles not traced at every pixel yet
+	mutable FrameArena				*m_arenas;	// one per thread, transient data of the frame being rendered
+	mutable int						m_arenaCount;
+	ThreadPlacement					m_placement;
+	mtl::Array<ThreadTopology::Cpu>	m_placedCpus;	// render thread i is pinned to cpu i modulo their count, empty unless placed
+	mutable mtl::Array<int>			m_threadNodes;	// NUMA node of every render thread while they are placed
+	int								m_nodeCount;	// 1 unless threads are placed on several nodes
+	bool							m_replicate;
+	mutable mtl::Array<VolumeMemory*>	m_replicas;	// a copy of the volume per node, see SetVolumeReplication
+	mutable const Voxel				*m_replicaSource;
+	mutable int						m_replicaDim;
+	mutable unsigned int			m_replicaGeneration;
+	bool							m_instrumented;
+	mutable FrameCounters			m_counters;
+	mutable mtl::Array<ThreadCounter>	m_threadCounters;
+	bool							m_perfEnabled;
+	mutable mtl::Array<PerfCounters*>	m_perfCounters;	// one per render thread, opened on it
+	mutable mtl::Array<PerfCounters::Values>	m_threadEvents;
 private:
-	CollisionInfo GetIntersection(Ray ray, const Voxel *volume, const int dim) const;
+	template < int octant, int Dim >
+	static CollisionInfo	GetIntersection(const Ray &ray, const Voxel *volume, const int p_dim);
+	template < int octant, int Dim >
+	static CollisionInfo	GetIntersectionFixed(const Ray &ray, const Voxel *volume, const int p_dim);
+	static const IntersectionKernel	*SelectKernels(TraversalMode p_mode, const int dim);
+	static void				CheckRay(const Ray &ray, const char *p_name, const Voxel *volume, const int dim, TraversalCheck &p_check, std::ostream &p_out);
+	bool					GetIntersectionFrom(const Ray &ray, float start, const Voxel *volume, const int dim, CollisionInfo &collisionInfo) const;
+	CollisionInfo			GetPrimaryIntersection(const Ray &ray, int x, int y, const Voxel *volume, const int dim) const;
+	void					Splat(const Camera &camera, const Frustum &frustum, const Voxel *volume, const int dim) const;
+	void					PrepareSkip(const Camera &camera, const Frustum &frustum) const;
+	void					UpdateSkip(const Camera &camera, const Frustum &frustum) const;
+	CollisionInfo			GetIntersection(const Ray &ray, const Voxel *volume, const int dim) const;
+	Frustum					GetFrustum(const Camera &camera) const;
+	void					AntiAlias(const Frustum &frustum, const Camera &camera, const Voxel *volume, const int dim) const;
+	TileRate				GetTileRate(int p_tileX, int p_tileY) const;
+	void					RenderTile(const Camera &camera, const Voxel *volume, const int dim, int p_tileX, int p_tileY, TileRate p_rate) const;
+	void					PrepareColumnDirections(const Frustum &frustum) const;
+	vec3_t					GetPixelDirection(int x, int y) const;
+	void					TracePixel(const Camera &camera, const Voxel *volume, const int dim, int x, int y) const;
+	static unsigned int		GetHitId(const CollisionInfo &collisionInfo);
+	int						GetBrightness(const CollisionInfo &collisionInfo, const vec3_t &direction) const;
+	static void				Shade(const CollisionInfo &collisionInfo, const vec3_t &direction, int brightness, int *rgb);
+	void					ShadeHit(const Ray &ray, const CollisionInfo &collisionInfo, const Voxel *volume, const int dim, int *rgb) const;
+	void					InitBuffers(int p_width, int p_height);
+	void					UpdateOrders( void );
+	void					LockFrame( void ) const;
+	void					PrepareArenas( void ) const;
+	void					ResetArenas( void ) const;
+	FrameArena				&GetThreadArena( void ) const;
+	void					BeginCounters( void ) const;
+	void					CountRays(int p_count) const;
+	void					EndCounters( void ) const;
+	bool					OpenPerfCounters( void ) const;
+	void					ClosePerfCounters( void ) const;
+	void					RememberFrame(const Camera &camera, const Voxel *volume, const int dim) const;
+	bool					IsSameView(const Camera &camera, const Voxel *volume, const int dim) const;
+	void					Accumulate(const Frustum &frustum, const Camera &camera, const Voxel *volume, const int dim) const;
+	void					TracePath(const Ray &ray, const Voxel *volume, const int dim, Uint32 &random, float *radiance) const;
+	void					RenderBudgeted(const Camera &camera, const Voxel *volume, const int dim, double deadline) const;
+	bool					RefineTile(const Camera &camera, const Voxel *volume, const int dim, int p_tile, int p_shift, double deadline) const;
+	int						GetTileError(int p_tile, int p_shift) const;
+	void					FillUntraced( void ) const;
+	static int				CompareRefineJobs(const void *a, const void *b);
+	void					RenderRows(const Frustum &frustum, const Camera &camera, const Voxel *volume, const int dim, int x0, int y0, int x1, int y1) const;
+	void					RenderTiles(const Camera &camera, const Voxel *volume, const int dim, const TileJob *jobs, int count) const;
+	void					PrepareReplicas(const Voxel *volume, const int dim) const;
+	void					PinThreads( void ) const;
+	void					ReleaseReplicas( void ) const;
+	const Voxel				*GetThreadVolume(const Voxel *volume) const;
 public:
 			Renderer( void );
+			~Renderer( void );
+	// presents frames in an SDL window
 	bool	Init(int p_width, int p_height, bool p_fullscreen);
+	// keeps frames in memory, see GetPixels
+	bool	InitHeadless(int p_width, int p_height);
+	// frames go to p_sink, which must outlive the renderer's use of it
+	bool	Init(FrameSink *p_sink);
 	void	CleanUp( void );
 	void	Render(const Camera &camera, const Voxel *volume, const int dim) const;
+	// traces the pixels in [x0,x1) x [y0,y1) one ray each, like Render without variable rate, antialiasing or
+	// temporal skipping; pixels get the same ray they get in Render, whatever its screen order or time budget
+	void	RenderRegion(const Camera &camera, const Voxel *volume, const int dim, int x0, int y0, int x1, int y1) const;
+	// hands the rendered frame to the sink
 	void	Refresh( void ) const;
+
+	// supersample pixels whose neighbours hit a different voxel, side, or nothing (p_samples <= 1 disables)
+	void	SetAntiAliasing(int p_samples, AntiAliasPattern p_pattern);
+	// trace TileSize x TileSize tiles at full, half or quarter ray density, and fill in the gaps from neighbouring hits
+	void	SetVariableRate(VariableRateMode p_mode);
+	// p_x and p_y are normalized screen coordinates, radii are in units of screen height
+	void	SetFocus(float p_x, float p_y, float p_fullRadius, float p_halfRadius);
+	void	SetTraversal(TraversalMode p_mode);
+	// traces p_rays reproducible random rays through the volume, every other one across it from a face, with
+	// both traversal modes and a reference that decides every step exactly instead of summing up distances;
+	// the rays a mode resolves differently are printed to p_out and counted in p_check
+	static void	CheckTraversal(const Voxel *volume, const int dim, int p_rays, TraversalCheck &p_check, std::ostream &p_out);
+	// the same through a volume from VolumeMemory::MapSparse, which may be far larger than memory: the cells
+	// along each ray's path are emptied before it is traced, across the whole volume or up to a random cell
+	static void	CheckTraversalPaths(VolumeMemory &p_volume, int p_rays, TraversalCheck &p_check, std::ostream &p_out);
+	// the same for the primary rays Render traces for the camera, once Init or InitHeadless succeeded; they are
+	// printed by p_view and their pixel
+	void	CheckTraversal(const Camera &camera, const char *p_view, const Voxel *volume, const int dim, TraversalCheck &p_check, std::ostream &p_out) const;
+	// the order in which pixels are traced, so that consecutive rays of a thread read neighbouring parts of the
+	// volume; any order but rows renders tiles, one thread at a time each
+	void	SetScreenOrder(ScreenOrder p_order);
+	// start primary rays close to the previous frame's closest hit in their tile instead of at the camera
+	void	SetTemporalSkip(bool p_enabled);
+	// rasterize the bounds of occupied bricks before tracing so that primary rays only traverse the distance
+	// interval the bricks cover, and rays that miss every brick are not traced at all
+	void	SetSplatting(bool p_enabled);
+	// call after the contents of a volume were changed in place
+	void	InvalidateVolume( void );
+	// true when Render would draw the frame that was last rendered: same camera pose, volume, volume generation
+	// and settings, so that idle loops can skip rendering and presenting
+	bool	IsFrameCurrent(const Camera &camera, const Voxel *volume, const int dim) const;
+	// makes IsFrameCurrent fail until the next Render, i.e. when the window needs repainting
+	void	InvalidateFrame( void );
+	// progressive path traced global illumination under a uniform white sky, at least p_samples per pixel and
+	// frame (0 disables); samples accumulate while the camera, volume and settings stay the same, and pixels
+	// that converged are not traced any more, until then IsFrameCurrent is false
+	void	SetGlobalIllumination(int p_samples);
+	// shade faces by the light level of the empty voxel in front of them; p_light must have been built for the
+	// volume passed to Render and outlive the renderer's use of it, NULL turns lighting off
+	void	SetLightVolume(const LightVolume *p_light);
+	// per voxel opacity laid out like the volume passed to Render, 255 opaque (NULL makes every solid voxel
+	// opaque); rays composite translucent voxels front to back until they are all but blocked, which primary
+	// rays and antialiasing samples do, path traced rays and light volumes take every solid voxel as opaque
+	void	SetOpacity(const byte_t *p_opacity);
+	int		GetUnconvergedCount( void ) const;
+	// Render stops tracing after p_ms (0 disables): a coarse pass traces one ray per tile, then the tiles whose
+	// samples disagree most are traced at twice the density until the time is up; a still view keeps being
+	// refined by the next Renders, until then IsFrameCurrent is false; a fully refined frame is the one Render
+	// draws without a budget. Variable rate and antialiasing are not used, global illumination takes precedence
+	void	SetTimeBudget(float p_ms);
+	// fraction of the screen traced at every pixel by now, 1 without a time budget
+	float	GetRefinement( void ) const;
+	// pins the render threads by the machine's topology and sets their count to the cpus used, so that threads
+	// on one NUMA node trace neighbouring screen regions; false when the topology is unknown
+	bool	SetThreadPlacement(ThreadPlacement p_placement);
+	// while threads are placed on several nodes, gives every node a copy of the volume that its threads read;
+	// the copies are made again after InvalidateVolume, so this is for volumes that seldom change; turn it off
+	// while a volume is being filled in, e.g. by a VolumeLoader
+	void	SetVolumeReplication(bool p_enabled);
+	int		GetNodeCount( void ) const;
+	// count rays per thread and tiles per rate while rendering, see GetCounters
+	void	SetInstrumentation(bool p_enabled);
+	bool	IsInstrumented( void ) const;
+	const FrameCounters	&GetCounters( void ) const;
+	// while instrumented, also count hardware events (cycles, instructions, cache, branch and TLB misses) on every
+	// render thread; false when none can be counted, e.g. off Linux or when perf_event_paranoid forbids it
+	bool	SetPerfCounters(bool p_enabled);
+
+	// the current or last frame; only valid until Refresh when the sink gave out its own memory
+	const pixel_t	*GetPixels( void ) const;
+	// the frame being rendered, for drawing over it between Render and Refresh; NULL outside of that
+	pixel_t			*GetFrame( void );
+	int				GetWidth( void ) const;
+	int				GetHeight( void ) const;
+	// per thread frame arenas, reset at the end of every Render
+	int				GetArenaCount( void ) const;
+	const FrameArena	&GetArena(int p_thread) const;
 };
 
 #endif
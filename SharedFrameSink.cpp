@@ -0,0 +1,148 @@
+#include <iostream>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define SHARED_FRAMES_SUPPORTED
+#endif
+
+#include "SharedFrameSink.h"
+
+// orders the pixel stores against the sequence numbers readers check
+static inline void PublishBarrier( void )
+{
+#ifdef __GNUC__
+	__sync_synchronize();
+#endif
+}
+
+static size_t RoundToPage(size_t p_bytes)
+{
+#ifdef SHARED_FRAMES_SUPPORTED
+	const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+#else
+	const size_t page = 4096;
+#endif
+	return (p_bytes + page - 1) / page * page;
+}
+
+SharedFrameSink::SharedFrameSink( void ) : m_header(NULL), m_memory(NULL), m_size(0), m_slot(-1)
+{
+	m_name[0] = '\0';
+}
+
+SharedFrameSink::~SharedFrameSink( void )
+{
+	CleanUp();
+}
+
+bool SharedFrameSink::Init(const char *p_name, int p_width, int p_height, int p_slotCount)
+{
+	CleanUp();
+#ifdef SHARED_FRAMES_SUPPORTED
+	if (p_width <= 0 || p_height <= 0 || p_slotCount < 2 || p_slotCount > SharedFrameHeader::MaxSlots || strlen(p_name) >= sizeof(m_name)) {
+		return false;
+	}
+
+	const size_t headerBytes = RoundToPage(sizeof(SharedFrameHeader));
+	const size_t slotBytes = RoundToPage(sizeof(pixel_t) * p_width * p_height);
+	const size_t size = headerBytes + slotBytes * p_slotCount;
+
+	const int fd = shm_open(p_name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		std::cout << "Could not open shared memory " << p_name << std::endl;
+		return false;
+	}
+	void *memory = MAP_FAILED;
+	if (ftruncate(fd, (off_t)size) == 0) {
+		memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (memory == MAP_FAILED) {
+		std::cout << "Could not map shared memory " << p_name << std::endl;
+		shm_unlink(p_name);
+		return false;
+	}
+
+	strcpy(m_name, p_name);
+	m_memory = (Uint8*)memory;
+	m_size = size;
+	m_header = (SharedFrameHeader*)memory;
+	m_header->width = (Uint32)p_width;
+	m_header->height = (Uint32)p_height;
+	m_header->slotCount = (Uint32)p_slotCount;
+	m_header->headerBytes = (Uint32)headerBytes;
+	m_header->slotBytes = (Uint32)slotBytes;
+	m_header->latest = 0;
+	for (int i = 0; i < SharedFrameHeader::MaxSlots; ++i) {
+		m_header->sequence[i] = 0;
+	}
+	m_header->version = SharedFrameHeader::Version;
+	PublishBarrier();
+	m_header->magic = SharedFrameHeader::Magic; // readers may start once this is set
+	return true;
+#else
+	std::cout << "Shared memory frames are not supported on this platform" << std::endl;
+	return false;
+#endif
+}
+
+void SharedFrameSink::CleanUp( void )
+{
+#ifdef SHARED_FRAMES_SUPPORTED
+	if (m_memory != NULL) {
+		m_header->magic = 0;
+		munmap(m_memory, m_size);
+		shm_unlink(m_name);
+	}
+#endif
+	m_name[0] = '\0';
+	m_header = NULL;
+	m_memory = NULL;
+	m_size = 0;
+	m_slot = -1;
+}
+
+int SharedFrameSink::GetWidth( void ) const
+{
+	return (m_header != NULL) ? (int)m_header->width : 0;
+}
+
+int SharedFrameSink::GetHeight( void ) const
+{
+	return (m_header != NULL) ? (int)m_header->height : 0;
+}
+
+pixel_t *SharedFrameSink::Lock( void )
+{
+	if (m_header == NULL) { return NULL; }
+	if (m_slot < 0) {
+		// never the slot readers are directed to, that one is only overwritten once a newer frame is published
+		m_slot = (int)(m_header->latest % m_header->slotCount);
+		++m_header->sequence[m_slot];
+		PublishBarrier();
+	}
+	return (pixel_t*)(m_memory + m_header->headerBytes + (size_t)m_header->slotBytes * m_slot);
+}
+
+void SharedFrameSink::Unlock(const pixel_t *p_pixels)
+{
+	if (m_header == NULL || m_slot < 0) { return; }
+	pixel_t *slot = (pixel_t*)(m_memory + m_header->headerBytes + (size_t)m_header->slotBytes * m_slot);
+	if (p_pixels != slot) {
+		memcpy(slot, p_pixels, sizeof(pixel_t) * m_header->width * m_header->height);
+	}
+	PublishBarrier();
+	++m_header->sequence[m_slot];
+	PublishBarrier();
+	++m_header->latest;
+	m_slot = -1;
+}
+
+int SharedFrameSink::GetPublishedCount( void ) const
+{
+	return (m_header != NULL) ? (int)m_header->latest : 0;
+}
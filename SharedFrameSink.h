@@ -0,0 +1,56 @@
+#ifndef SHAREDFRAMESINK_H_INCLUDED__
+#define SHAREDFRAMESINK_H_INCLUDED__
+
+#include "FrameSink.h"
+
+// Layout of the start of the shared memory object. Slot i's pixels start at
+// headerBytes + i * slotBytes, both of which are multiples of the page size.
+//
+// Readers map the object read only and, for every frame they want:
+//  1. read latest; the frame is in slot (latest - 1) % slotCount, nothing was published while latest is 0
+//  2. read sequence[slot], retry later if it is odd (the slot is being written)
+//  3. use the pixels in place
+//  4. read sequence[slot] again; the pixels were consistent if it did not change
+struct SharedFrameHeader
+{
+	enum { Magic = 0x46545256 }; // "VRTF"
+	enum { Version = 1 };
+	enum { MaxSlots = 16 };
+
+	Uint32			magic;
+	Uint32			version;
+	Uint32			width, height;	// pixels, 32-bit 0x00RRGGBB, rows are not padded
+	Uint32			slotCount;
+	Uint32			headerBytes;
+	Uint32			slotBytes;
+	volatile Uint32	latest;			// frames published so far
+	volatile Uint32	sequence[MaxSlots];
+};
+
+// Publishes frames to a POSIX shared memory ring that local processes can read
+// without copying. The renderer writes straight into the ring.
+class SharedFrameSink : public FrameSink
+{
+private:
+	char				m_name[256];
+	SharedFrameHeader	*m_header;
+	Uint8				*m_memory;
+	size_t				m_size;
+	int					m_slot;		// slot handed out by Lock, -1 when none
+private:
+						SharedFrameSink(const SharedFrameSink&) {}
+	SharedFrameSink		&operator=(const SharedFrameSink&) { return *this; }
+public:
+				SharedFrameSink( void );
+				~SharedFrameSink( void );
+	// p_name is a shared memory object name, i.e. "/voxelframes"
+	bool		Init(const char *p_name, int p_width, int p_height, int p_slotCount);
+	void		CleanUp( void );
+	int			GetWidth( void ) const;
+	int			GetHeight( void ) const;
+	pixel_t		*Lock( void );
+	void		Unlock(const pixel_t *p_pixels);
+	int			GetPublishedCount( void ) const;
+};
+
+#endif
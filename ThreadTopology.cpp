@@ -0,0 +1,163 @@
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef __linux__
+#include <sched.h>
+#include <pthread.h>
+#define THREAD_TOPOLOGY_SUPPORTED
+#endif
+
+#include "ThreadTopology.h"
+
+#ifdef THREAD_TOPOLOGY_SUPPORTED
+
+enum { MaxNodes = 1024 };
+
+// the cpus the process was started on, before any thread was pinned
+static const cpu_set_t &GetProcessCpus( void )
+{
+	static cpu_set_t cpus;
+	static bool read = false;
+	if (!read) {
+		CPU_ZERO(&cpus);
+		if (sched_getaffinity(0, sizeof(cpus), &cpus) != 0) {
+			for (int i = 0; i < CPU_SETSIZE; ++i) { CPU_SET(i, &cpus); }
+		}
+		read = true;
+	}
+	return cpus;
+}
+
+static bool ReadInt(const char *p_path, int &p_value)
+{
+	FILE *file = fopen(p_path, "r");
+	if (file == NULL) { return false; }
+	const bool success = fscanf(file, "%d", &p_value) == 1;
+	fclose(file);
+	return success;
+}
+
+// marks the cpus of a sysfs cpu list ("0-3,8,10-11") with p_value in p_cpus
+static bool ReadCpuList(const char *p_path, int *p_cpus, int p_value)
+{
+	FILE *file = fopen(p_path, "r");
+	if (file == NULL) { return false; }
+	int first, last;
+	while (fscanf(file, "%d", &first) == 1) {
+		last = first;
+		int separator = fgetc(file);
+		if (separator == '-') {
+			if (fscanf(file, "%d", &last) != 1) { break; }
+			separator = fgetc(file);
+		}
+		for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) {
+			if (cpu >= 0) { p_cpus[cpu] = p_value; }
+		}
+		if (separator != ',') { break; }
+	}
+	fclose(file);
+	return true;
+}
+
+static int CompareCpus(const void *a, const void *b)
+{
+	const ThreadTopology::Cpu &l = *(const ThreadTopology::Cpu*)a;
+	const ThreadTopology::Cpu &r = *(const ThreadTopology::Cpu*)b;
+	if (l.node != r.node)		{ return l.node - r.node; }
+	if (l.package != r.package)	{ return l.package - r.package; }
+	if (l.core != r.core)		{ return l.core - r.core; }
+	return l.id - r.id;
+}
+
+#endif
+
+ThreadTopology::ThreadTopology( void ) : m_nodeCount(0), m_coreCount(0) {}
+
+bool ThreadTopology::Read(SmtPolicy p_policy)
+{
+	m_cpus.Clear();
+	m_nodeCount = m_coreCount = 0;
+#ifdef THREAD_TOPOLOGY_SUPPORTED
+	static int nodes[CPU_SETSIZE];
+	for (int i = 0; i < CPU_SETSIZE; ++i) { nodes[i] = 0; }
+	char path[128];
+	for (int node = 0, dense = 0; node < MaxNodes; ++node) {
+		sprintf(path, "/sys/devices/system/node/node%d/cpulist", node);
+		if (ReadCpuList(path, nodes, dense)) { ++dense; }
+	}
+
+	const cpu_set_t &allowed = GetProcessCpus();
+	for (int id = 0; id < CPU_SETSIZE; ++id) {
+		if (!CPU_ISSET(id, &allowed)) { continue; }
+		Cpu cpu;
+		cpu.id = id;
+		cpu.node = nodes[id];
+		cpu.sibling = 0;
+		sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", id);
+		if (!ReadInt(path, cpu.package)) { continue; } // offline
+		sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/core_id", id);
+		if (!ReadInt(path, cpu.core)) { continue; }
+		m_cpus.PushBack(cpu);
+	}
+	if (m_cpus.GetSize() == 0) { return false; }
+
+	qsort(m_cpus.GetData(), m_cpus.GetSize(), sizeof(Cpu), CompareCpus);
+	for (int i = m_cpus.GetSize() - 1; i >= 0; --i) {
+		const bool sameCore = i > 0 && m_cpus[i - 1].node == m_cpus[i].node && m_cpus[i - 1].package == m_cpus[i].package && m_cpus[i - 1].core == m_cpus[i].core;
+		m_cpus[i].sibling = sameCore ? 1 : 0; // counted up below, from the first sibling
+	}
+	// nodes the process may not run on are left out of the numbering
+	mtl::Array<Cpu> selected;
+	int node = -1;
+	for (int i = 0; i < m_cpus.GetSize(); ++i) {
+		Cpu cpu = m_cpus[i];
+		if (i == 0 || cpu.node != m_cpus[i - 1].node) { ++node; }
+		cpu.node = node;
+		cpu.sibling = (cpu.sibling > 0) ? m_cpus[i - 1].sibling + 1 : 0;
+		m_cpus[i].sibling = cpu.sibling;
+		if (cpu.sibling == 0) { ++m_coreCount; }
+		if (p_policy == SMT_ALL || cpu.sibling == 0) { selected.PushBack(cpu); }
+	}
+	m_nodeCount = node + 1;
+	m_cpus = selected;
+	return true;
+#else
+	(void)p_policy;
+	return false;
+#endif
+}
+
+int ThreadTopology::GetCpuCount( void ) const
+{
+	return m_cpus.GetSize();
+}
+
+const ThreadTopology::Cpu &ThreadTopology::GetCpu(int p_index) const
+{
+	return m_cpus[p_index];
+}
+
+int ThreadTopology::GetNodeCount( void ) const
+{
+	return m_nodeCount;
+}
+
+int ThreadTopology::GetCoreCount( void ) const
+{
+	return m_coreCount;
+}
+
+bool ThreadTopology::Pin(int p_cpu)
+{
+#ifdef THREAD_TOPOLOGY_SUPPORTED
+	cpu_set_t cpus = GetProcessCpus();
+	if (p_cpu >= 0) {
+		CPU_ZERO(&cpus);
+		CPU_SET(p_cpu, &cpus);
+	}
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+#else
+	(void)p_cpu;
+	return false;
+#endif
+}
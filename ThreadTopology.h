@@ -0,0 +1,42 @@
+#ifndef THREADTOPOLOGY_H_INCLUDED__
+#define THREADTOPOLOGY_H_INCLUDED__
+
+#include "mtlArray.h"
+
+// The hardware threads the process may run on and where they sit (NUMA node,
+// package and core), read from Linux sysfs. Cpus are ordered by node, package,
+// core and then SMT sibling, so that consecutive render threads share a core, a
+// socket and the memory attached to it. Elsewhere the topology is unknown.
+class ThreadTopology
+{
+public:
+	enum SmtPolicy
+	{
+		SMT_ALL,			// every hardware thread, a core's siblings next to each other
+		SMT_ONE_PER_CORE	// the first hardware thread of every core
+	};
+	struct Cpu
+	{
+		int	id;			// as the kernel numbers it
+		int	node;		// NUMA node, renumbered from 0
+		int	package;
+		int	core;		// within the package
+		int	sibling;	// among the core's hardware threads
+	};
+private:
+	mtl::Array<Cpu>	m_cpus;
+	int				m_nodeCount;
+	int				m_coreCount;
+public:
+					ThreadTopology( void );
+	// false when the topology can not be read
+	bool			Read(SmtPolicy p_policy);
+	int				GetCpuCount( void ) const;
+	const Cpu		&GetCpu(int p_index) const;
+	int				GetNodeCount( void ) const;
+	int				GetCoreCount( void ) const;
+	// pins the calling thread to one cpu (by kernel number), -1 lets it run on every cpu the process started with
+	static bool		Pin(int p_cpu);
+};
+
+#endif
@@ -0,0 +1,135 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define MAPPED_VOLUMES_SUPPORTED
+#endif
+
+#include "VolumeFile.h"
+
+static bool WriteVolume(FILE *file, const Voxel *p_volume, int p_dim)
+{
+	VolumeFileHeader header;
+	header.magic = VolumeFileHeader::Magic;
+	header.version = VolumeFileHeader::Version;
+	header.dim = (Uint32)p_dim;
+	header.voxelBytes = (Uint32)sizeof(Voxel);
+	const size_t count = (size_t)p_dim * p_dim * p_dim;
+	const bool success =
+		fwrite(&header, sizeof(header), 1, file) == 1 &&
+		fwrite(p_volume, sizeof(Voxel), count, file) == count;
+	return (fclose(file) == 0) && success;
+}
+
+bool SaveVolume(const char *p_file, const Voxel *p_volume, int p_dim)
+{
+	FILE *file = fopen(p_file, "wb");
+	if (file == NULL) { return false; }
+	return WriteVolume(file, p_volume, p_dim);
+}
+
+bool SaveTempVolume(char *p_file, size_t p_size, const Voxel *p_volume, int p_dim)
+{
+#ifdef MAPPED_VOLUMES_SUPPORTED
+	const char *directory = getenv("TMPDIR");
+	if (directory == NULL || directory[0] == '\0') { directory = "/tmp"; }
+	const int length = snprintf(p_file, p_size, "%s/voxelraytrace.XXXXXX", directory);
+	if (length < 0 || (size_t)length >= p_size) { return false; }
+	const int fd = mkstemp(p_file);
+	if (fd < 0) { return false; }
+	FILE *file = fdopen(fd, "wb");
+	if (file == NULL) {
+		close(fd);
+		remove(p_file);
+		return false;
+	}
+	if (!WriteVolume(file, p_volume, p_dim)) {
+		remove(p_file);
+		return false;
+	}
+	return true;
+#else
+	(void)p_file;
+	(void)p_size;
+	(void)p_volume;
+	(void)p_dim;
+	return false;
+#endif
+}
+
+MappedVolume::MappedVolume( void ) : m_memory(NULL), m_size(0), m_voxels(NULL), m_dim(0) {}
+
+MappedVolume::~MappedVolume( void )
+{
+	Close();
+}
+
+bool MappedVolume::Open(const char *p_file)
+{
+	Close();
+#ifdef MAPPED_VOLUMES_SUPPORTED
+	const int fd = open(p_file, O_RDONLY);
+	if (fd < 0) {
+		std::cout << "Could not open volume " << p_file << std::endl;
+		return false;
+	}
+	struct stat info;
+	void *memory = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(VolumeFileHeader)) {
+		memory = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (memory == MAP_FAILED) {
+		std::cout << "Could not map volume " << p_file << std::endl;
+		return false;
+	}
+
+	const VolumeFileHeader *header = (const VolumeFileHeader*)memory;
+	const size_t bytes = GetVolumeBytes(header->dim);
+	if (
+		header->magic != VolumeFileHeader::Magic || header->version != VolumeFileHeader::Version ||
+		header->voxelBytes != sizeof(Voxel) || bytes == 0 || (size_t)info.st_size - sizeof(VolumeFileHeader) < bytes
+	) {
+		std::cout << "Not a volume file: " << p_file << std::endl;
+		munmap(memory, (size_t)info.st_size);
+		return false;
+	}
+
+	m_memory = memory;
+	m_size = (size_t)info.st_size;
+	m_voxels = (const Voxel*)(header + 1);
+	m_dim = (int)header->dim;
+	return true;
+#else
+	std::cout << "Mapped volumes are not supported on this platform" << std::endl;
+	return false;
+#endif
+}
+
+void MappedVolume::Close( void )
+{
+#ifdef MAPPED_VOLUMES_SUPPORTED
+	if (m_memory != NULL) {
+		munmap(m_memory, m_size);
+	}
+#endif
+	m_memory = NULL;
+	m_size = 0;
+	m_voxels = NULL;
+	m_dim = 0;
+}
+
+const Voxel *MappedVolume::GetVoxels( void ) const
+{
+	return m_voxels;
+}
+
+int MappedVolume::GetDim( void ) const
+{
+	return m_dim;
+}
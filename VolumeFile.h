@@ -0,0 +1,46 @@
+#ifndef VOLUMEFILE_H_INCLUDED__
+#define VOLUMEFILE_H_INCLUDED__
+
+#include <cstddef>
+#include "Voxel.h"
+
+// Raw volume file: the header followed by dim^3 Voxels, x varying fastest,
+// in the same layout Renderer::Render takes them.
+struct VolumeFileHeader
+{
+	enum { Magic = 0x4c4f5656 }; // "VVOL"
+	enum { Version = 1 };
+
+	Uint32	magic;
+	Uint32	version;
+	Uint32	dim;
+	Uint32	voxelBytes;	// sizeof(Voxel) of the program that wrote the file
+};
+
+bool SaveVolume(const char *p_file, const Voxel *p_volume, int p_dim);
+// saves to a new file in the temporary directory ($TMPDIR, or /tmp) and puts its name into p_file, which has
+// room for p_size characters; the file is the caller's to remove
+bool SaveTempVolume(char *p_file, size_t p_size, const Voxel *p_volume, int p_dim);
+
+// Read only view of a volume file mapped into memory, so that processes
+// rendering the same volume share one copy of it.
+class MappedVolume
+{
+private:
+	void			*m_memory;
+	size_t			m_size;
+	const Voxel		*m_voxels;
+	int				m_dim;
+private:
+					MappedVolume(const MappedVolume&) {}
+	MappedVolume	&operator=(const MappedVolume&) { return *this; }
+public:
+					MappedVolume( void );
+					~MappedVolume( void );
+	bool			Open(const char *p_file);
+	void			Close( void );
+	const Voxel		*GetVoxels( void ) const;
+	int				GetDim( void ) const;
+};
+
+#endif
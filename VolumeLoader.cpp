@@ -0,0 +1,363 @@
+#define _FILE_OFFSET_BITS 64 // off_t of 64 bits for fseeko on 32 bit systems
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+
+#include "VolumeLoader.h"
+#include "VolumeFile.h"
+#include "Math3d.h"
+
+// volume files outgrow what a long can address on systems where it has 32 bits
+static bool SeekFile(FILE *p_file, unsigned long long p_offset)
+{
+#ifdef _WIN32
+	return _fseeki64(p_file, (__int64)p_offset, SEEK_SET) == 0;
+#else
+	return fseeko(p_file, (off_t)p_offset, SEEK_SET) == 0;
+#endif
+}
+
+static bool IsVoxFile(const char *p_file)
+{
+	const size_t length = strlen(p_file);
+	if (length < 4) { return false; }
+	const char *extension = p_file + length - 4;
+	return extension[0] == '.' && (extension[1] | 0x20) == 'v' && (extension[2] | 0x20) == 'o' && (extension[3] | 0x20) == 'x';
+}
+
+int VolumeLoader::LoaderMain(void *p_loader)
+{
+	VolumeLoader *loader = (VolumeLoader*)p_loader;
+	bool success = loader->m_isVox ? loader->LoadVoxFile() : loader->LoadVolumeFile();
+	loader->m_scene.CleanUp();
+
+	if (success && loader->m_light != NULL) {
+		// the light is built from the whole volume, once Publish wrote the last batch
+		SDL_mutexP(loader->m_lock);
+		while ((loader->m_readyCount > 0 || loader->m_freeCount < BatchCount) && !loader->m_quit) {
+			SDL_CondWait(loader->m_changed, loader->m_lock);
+		}
+		success = !loader->m_quit;
+		SDL_mutexV(loader->m_lock);
+		if (success) {
+			loader->m_light->Build(loader->m_voxels, loader->m_dim);
+		}
+	}
+
+	SDL_mutexP(loader->m_lock);
+	loader->m_failed = !success;
+	loader->m_finished = true;
+	SDL_CondBroadcast(loader->m_changed);
+	SDL_mutexV(loader->m_lock);
+	return 0;
+}
+
+bool VolumeLoader::Allocate(int p_dim, double p_total, bool p_translucent)
+{
+	if (!m_memory.Allocate(p_dim)) { return false; }
+	SDL_mutexP(m_lock);
+	if (p_translucent) {
+		m_opacity.Resize(p_dim * p_dim * p_dim);
+		memset(m_opacity.GetData(), 255, (size_t)m_opacity.GetSize());
+	}
+	m_voxels = m_memory.GetVoxels();
+	m_dim = p_dim;
+	m_total = p_total;
+	SDL_mutexV(m_lock);
+	return true;
+}
+
+VolumeLoader::Batch *VolumeLoader::AcquireBatch( void )
+{
+	SDL_mutexP(m_lock);
+	while (m_freeCount == 0 && !m_quit) {
+		SDL_CondWait(m_changed, m_lock); // backpressure, the render loop has not published enough yet
+	}
+	Batch *batch = m_quit ? NULL : &m_batches[m_free[--m_freeCount]];
+	SDL_mutexV(m_lock);
+	return batch;
+}
+
+void VolumeLoader::SubmitBatch(Batch *p_batch)
+{
+	SDL_mutexP(m_lock);
+	m_ready[(m_readyHead + m_readyCount) % BatchCount] = int( p_batch - m_batches );
+	++m_readyCount;
+	SDL_CondBroadcast(m_changed);
+	SDL_mutexV(m_lock);
+}
+
+bool VolumeLoader::LoadVolumeFile( void )
+{
+	FILE *file = fopen(m_file, "rb");
+	if (file == NULL) {
+		std::cout << "Could not open volume " << m_file << std::endl;
+		return false;
+	}
+	VolumeFileHeader header;
+	if (
+		fread(&header, sizeof(header), 1, file) != 1 ||
+		header.magic != VolumeFileHeader::Magic || header.version != VolumeFileHeader::Version ||
+		header.voxelBytes != sizeof(Voxel) || GetVolumeBytes(header.dim) == 0
+	) {
+		std::cout << "Not a volume file: " << m_file << std::endl;
+		fclose(file);
+		return false;
+	}
+	const int dim = (int)header.dim;
+	const size_t planeVoxels = (size_t)dim * dim;
+	if (!Allocate(dim, double( planeVoxels ) * dim, false)) {
+		fclose(file);
+		return false;
+	}
+
+	// planes from the middle outwards, the middle one first
+	bool success = true;
+	for (int k = 0; k < dim && success; ++k) {
+		const int z = dim / 2 + ((k & 1) ? -(k + 1) / 2 : k / 2);
+		for (size_t start = 0; start < planeVoxels && success; start += BatchVoxels) {
+			Batch *batch = AcquireBatch();
+			if (batch == NULL) { success = false; break; }
+			batch->offset = z * planeVoxels + start;
+			batch->count = (int)Min2(planeVoxels - start, (size_t)BatchVoxels);
+			success =
+				SeekFile(file, sizeof(header) + (unsigned long long)batch->offset * sizeof(Voxel)) &&
+				fread(batch->voxels, sizeof(Voxel), (size_t)batch->count, file) == (size_t)batch->count;
+			if (success) {
+				SubmitBatch(batch);
+			} else {
+				std::cout << "Could not read volume " << m_file << std::endl;
+			}
+		}
+	}
+	fclose(file);
+	return success;
+}
+
+bool VolumeLoader::LoadVoxFile( void )
+{
+	if (!m_scene.Open(m_file)) { return false; }
+	double total = 0.0;
+	for (int i = 0; i < m_scene.GetModelCount(); ++i) {
+		total += m_scene.GetModelVoxelCount(i);
+	}
+	if (!Allocate(m_scene.GetDim(), total, m_scene.IsTranslucent())) { return false; }
+
+	// models in order, so that later models still end up over earlier ones
+	for (int i = 0; i < m_scene.GetModelCount(); ++i) {
+		const int count = m_scene.GetModelVoxelCount(i);
+		for (int first = 0; first < count; first += BatchVoxels) {
+			Batch *batch = AcquireBatch();
+			if (batch == NULL) { return false; }
+			batch->offset = 0;
+			batch->count = Min2(count - first, (int)BatchVoxels);
+			m_scene.DecodeRange(i, first, batch->count, batch->indices, batch->voxels, m_scene.IsTranslucent() ? batch->opacity : NULL);
+			SubmitBatch(batch);
+		}
+	}
+	return true;
+}
+
+void VolumeLoader::Apply(const Batch &p_batch)
+{
+	if (p_batch.indices == NULL) {
+		memcpy(m_voxels + p_batch.offset, p_batch.voxels, sizeof(Voxel) * p_batch.count);
+		return;
+	}
+	byte_t *opacity = (m_opacity.GetSize() > 0) ? m_opacity.GetData() : NULL;
+	for (int i = 0; i < p_batch.count; ++i) {
+		if (p_batch.indices[i] != VoxScene::InvalidIndex) {
+			m_voxels[p_batch.indices[i]] = p_batch.voxels[i];
+			if (opacity != NULL) {
+				opacity[p_batch.indices[i]] = p_batch.opacity[i];
+			}
+		}
+	}
+}
+
+VolumeLoader::VolumeLoader( void ) : m_isVox(false), m_light(NULL), m_voxels(NULL), m_dim(0), m_total(0.0), m_published(0.0), m_freeCount(0), m_readyHead(0), m_readyCount(0), m_finished(false), m_failed(false), m_quit(false), m_thread(NULL), m_lock(NULL), m_changed(NULL)
+{
+	m_file[0] = '\0';
+	for (int i = 0; i < BatchCount; ++i) {
+		m_batches[i].voxels = NULL;
+		m_batches[i].indices = NULL;
+		m_batches[i].opacity = NULL;
+	}
+}
+
+VolumeLoader::~VolumeLoader( void )
+{
+	CleanUp();
+}
+
+bool VolumeLoader::Start(const char *p_file, LightVolume *p_light)
+{
+	CleanUp();
+	strncpy(m_file, p_file, sizeof(m_file) - 1);
+	m_file[sizeof(m_file) - 1] = '\0';
+	m_isVox = IsVoxFile(p_file);
+	m_light = p_light;
+	for (int i = 0; i < BatchCount; ++i) {
+		m_batches[i].voxels = new Voxel[BatchVoxels];
+		m_batches[i].indices = m_isVox ? new Uint32[BatchVoxels] : NULL;
+		m_batches[i].opacity = m_isVox ? new byte_t[BatchVoxels] : NULL;
+		m_free[i] = i;
+	}
+	m_freeCount = BatchCount;
+	m_readyHead = m_readyCount = 0;
+	m_finished = m_failed = m_quit = false;
+
+	m_lock = SDL_CreateMutex();
+	m_changed = SDL_CreateCond();
+	m_thread = SDL_CreateThread(LoaderMain, this);
+	if (m_thread == NULL) {
+		std::cout << "Could not start loading " << p_file << std::endl;
+		CleanUp();
+		return false;
+	}
+	return true;
+}
+
+bool VolumeLoader::Publish(Uint32 p_budgetMs)
+{
+	if (m_lock == NULL) { return false; }
+	const Uint32 start = SDL_GetTicks();
+	bool changed = false;
+	do {
+		SDL_mutexP(m_lock);
+		if (m_readyCount == 0) {
+			SDL_mutexV(m_lock);
+			break;
+		}
+		const int index = m_ready[m_readyHead];
+		m_readyHead = (m_readyHead + 1) % BatchCount;
+		--m_readyCount;
+		SDL_mutexV(m_lock);
+
+		// the loader does not touch a batch until it is back on the free stack
+		Apply(m_batches[index]);
+		changed = true;
+
+		SDL_mutexP(m_lock);
+		m_published += m_batches[index].count;
+		m_free[m_freeCount++] = index;
+		SDL_CondBroadcast(m_changed);
+		SDL_mutexV(m_lock);
+	} while (SDL_GetTicks() - start < p_budgetMs);
+	return changed;
+}
+
+bool VolumeLoader::Wait( void )
+{
+	if (m_lock == NULL) { return false; }
+	for (;;) {
+		Publish(0xffffffff);
+		SDL_mutexP(m_lock);
+		const bool done = m_finished && m_readyCount == 0;
+		if (!done && m_readyCount == 0) {
+			SDL_CondWait(m_changed, m_lock);
+		}
+		SDL_mutexV(m_lock);
+		if (done) { break; }
+	}
+	return !m_failed;
+}
+
+void VolumeLoader::CleanUp( void )
+{
+	if (m_lock != NULL) {
+		SDL_mutexP(m_lock);
+		m_quit = true;
+		SDL_CondBroadcast(m_changed);
+		SDL_mutexV(m_lock);
+		if (m_thread != NULL) {
+			SDL_WaitThread(m_thread, NULL);
+			m_thread = NULL;
+		}
+		SDL_DestroyCond(m_changed);
+		SDL_DestroyMutex(m_lock);
+		m_changed = NULL;
+		m_lock = NULL;
+	}
+	for (int i = 0; i < BatchCount; ++i) {
+		delete [] m_batches[i].voxels;
+		delete [] m_batches[i].indices;
+		delete [] m_batches[i].opacity;
+		m_batches[i].voxels = NULL;
+		m_batches[i].indices = NULL;
+		m_batches[i].opacity = NULL;
+	}
+	m_memory.CleanUp();
+	m_opacity.Free();
+	m_voxels = NULL;
+	m_dim = 0;
+	m_total = m_published = 0.0;
+	m_freeCount = m_readyHead = m_readyCount = 0;
+	m_finished = m_failed = m_quit = false;
+	m_light = NULL;
+}
+
+bool VolumeLoader::IsStarted( void ) const
+{
+	return m_lock != NULL;
+}
+
+bool VolumeLoader::IsDone( void ) const
+{
+	if (m_lock == NULL) { return false; }
+	SDL_mutexP(m_lock);
+	const bool done = m_finished && !m_failed && m_readyCount == 0;
+	SDL_mutexV(m_lock);
+	return done;
+}
+
+bool VolumeLoader::HasFailed( void ) const
+{
+	if (m_lock == NULL) { return false; }
+	SDL_mutexP(m_lock);
+	const bool failed = m_finished && m_failed;
+	SDL_mutexV(m_lock);
+	return failed;
+}
+
+float VolumeLoader::GetProgress( void ) const
+{
+	if (m_lock == NULL) { return 0.f; }
+	SDL_mutexP(m_lock);
+	const float progress = (m_total > 0.0) ? float( m_published / m_total ) : 0.f;
+	SDL_mutexV(m_lock);
+	return progress;
+}
+
+const Voxel *VolumeLoader::GetVoxels( void ) const
+{
+	if (m_lock == NULL) { return NULL; }
+	SDL_mutexP(m_lock);
+	const Voxel *voxels = m_voxels;
+	SDL_mutexV(m_lock);
+	return voxels;
+}
+
+const byte_t *VolumeLoader::GetOpacity( void ) const
+{
+	if (m_lock == NULL) { return NULL; }
+	SDL_mutexP(m_lock);
+	const byte_t *opacity = (m_opacity.GetSize() > 0) ? m_opacity.GetData() : NULL;
+	SDL_mutexV(m_lock);
+	return opacity;
+}
+
+const VolumeMemory &VolumeLoader::GetMemory( void ) const
+{
+	return m_memory;
+}
+
+int VolumeLoader::GetDim( void ) const
+{
+	if (m_lock == NULL) { return 0; }
+	SDL_mutexP(m_lock);
+	const int dim = m_dim;
+	SDL_mutexV(m_lock);
+	return dim;
+}
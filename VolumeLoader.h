@@ -0,0 +1,96 @@
+#ifndef VOLUMELOADER_H_INCLUDED__
+#define VOLUMELOADER_H_INCLUDED__
+
+#include "PlatformSDL.h"
+#include "Voxel.h"
+#include "VoxFile.h"
+#include "VolumeMemory.h"
+#include "LightVolume.h"
+
+// Loads a volume file (see VolumeFile.h) or a MagicaVoxel scene on a background
+// thread while the volume is already being rendered. The volume is allocated
+// empty as soon as its size is known, then the loader reads or decodes it in
+// batches of at most BatchVoxels voxels. Volume files are read a z plane at a
+// time from the middle outwards, since that is where cameras start. The batches
+// are only copied into the volume by Publish, which the render loop calls
+// between frames, so a frame never sees a batch half written; regions that are
+// not loaded yet are empty. When given a light volume the loader builds its sky
+// light once the last batch was published.
+class VolumeLoader
+{
+public:
+	enum { BatchVoxels = 256 * 1024 };
+	enum { BatchCount = 8 };	// the loader waits when this many batches wait to be published
+private:
+	// voxels for a span of the volume starting at offset, or scattered to indices when there are any
+	// (VoxScene::InvalidIndex skips a voxel), with their opacities for translucent scenes
+	struct Batch
+	{
+		size_t	offset;
+		int		count;
+		Voxel	*voxels;
+		Uint32	*indices;
+		byte_t	*opacity;
+	};
+private:
+	char			m_file[256];
+	bool			m_isVox;
+	VoxScene		m_scene;
+	LightVolume		*m_light;
+	VolumeMemory	m_memory;
+	Voxel			*m_voxels;		// m_memory's once its size is known
+	mtl::Array<byte_t>	m_opacity;	// per voxel, only for translucent scenes
+	int				m_dim;			// 0 until the volume is allocated
+	double			m_total;		// voxels that will be published
+	double			m_published;
+	Batch			m_batches[BatchCount];
+	int				m_free[BatchCount];	// stack of batches the loader can fill
+	int				m_freeCount;
+	int				m_ready[BatchCount];	// fifo of batches that wait to be published
+	int				m_readyHead, m_readyCount;
+	bool			m_finished;		// the loader thread is done, successfully or not
+	bool			m_failed;
+	bool			m_quit;
+	SDL_Thread		*m_thread;
+	SDL_mutex		*m_lock;
+	SDL_cond		*m_changed;
+private:
+					VolumeLoader(const VolumeLoader&) {}
+	VolumeLoader	&operator=(const VolumeLoader&) { return *this; }
+	static int		LoaderMain(void *p_loader);
+	bool			LoadVolumeFile( void );
+	bool			LoadVoxFile( void );
+	bool			Allocate(int p_dim, double p_total, bool p_translucent);
+	Batch			*AcquireBatch( void );
+	void			SubmitBatch(Batch *p_batch);
+	void			Apply(const Batch &p_batch);
+public:
+					VolumeLoader( void );
+					~VolumeLoader( void );
+	// starts loading p_file, .vox files as MagicaVoxel scenes; p_light (may be NULL) is built for the volume
+	// once it is loaded and must not be used before IsDone
+	bool			Start(const char *p_file, LightVolume *p_light);
+	// copies loaded batches into the volume for at most p_budgetMs, call between frames; true when the volume
+	// changed, i.e. Renderer::InvalidateVolume is due
+	bool			Publish(Uint32 p_budgetMs);
+	// publishes until the volume is complete, false when it could not be loaded
+	bool			Wait( void );
+	// stops loading and frees the volume
+	void			CleanUp( void );
+	bool			IsStarted( void ) const;
+	// everything is published and the light volume is built
+	bool			IsDone( void ) const;
+	bool			HasFailed( void ) const;
+	// fraction of the voxels published, 0 to 1
+	float			GetProgress( void ) const;
+	// NULL and 0 until the size of the volume is known
+	const Voxel		*GetVoxels( void ) const;
+	// per voxel opacity of a translucent scene, see Renderer::SetOpacity; NULL for opaque ones and until the
+	// size of the volume is known
+	const byte_t	*GetOpacity( void ) const;
+	int				GetDim( void ) const;
+	// only to be used once IsDone
+	const VolumeMemory	&GetMemory( void ) const;
+};
+
+#endif
@@ -0,0 +1,205 @@
+#include <iostream>
+#include <cstdio>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define VOLUME_MAPPING_SUPPORTED
+#ifdef MAP_NORESERVE
+static const int SparseFlags = MAP_PRIVATE | MAP_ANON | MAP_NORESERVE;
+#else
+static const int SparseFlags = MAP_PRIVATE | MAP_ANON;
+#endif
+#endif
+
+#include "VolumeMemory.h"
+
+VolumeMemory::VolumeMemory( void ) : m_voxels(NULL), m_dim(0), m_bytes(0), m_mappedBytes(0), m_advised(false) {}
+
+VolumeMemory::~VolumeMemory( void )
+{
+	CleanUp();
+}
+
+bool VolumeMemory::Reserve(int p_dim)
+{
+	CleanUp();
+	const size_t bytes = GetVolumeBytes(p_dim);
+	if (bytes == 0 || bytes > ~size_t( 0 ) - HugePageSize * 2) {
+		std::cout << "A " << p_dim << "^3 volume does not fit in the address space" << std::endl;
+		return false;
+	}
+
+	Voxel *voxels = NULL;
+#ifdef VOLUME_MAPPING_SUPPORTED
+	// mapped a huge page larger than needed so that it can start on a huge page boundary, the slack is given back
+	const size_t mapped = (bytes + HugePageSize - 1) & ~size_t( HugePageSize - 1 );
+	char *memory = (char*)mmap(NULL, mapped + HugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+	if (memory != (char*)MAP_FAILED) {
+		char *aligned = memory + ((HugePageSize - (size_t)memory % HugePageSize) % HugePageSize);
+		if (aligned > memory) {
+			munmap(memory, size_t( aligned - memory ));
+		}
+		if (memory + mapped + HugePageSize > aligned + mapped) {
+			munmap(aligned + mapped, size_t( (memory + mapped + HugePageSize) - (aligned + mapped) ));
+		}
+	#ifdef MADV_HUGEPAGE
+		m_advised = madvise(aligned, mapped, MADV_HUGEPAGE) == 0;
+	#endif
+		voxels = (Voxel*)aligned;
+		m_mappedBytes = mapped;
+	}
+#endif
+	if (voxels == NULL) {
+		voxels = (Voxel*)::operator new(bytes, std::nothrow);
+	}
+	if (voxels == NULL) {
+		std::cout << "Not enough memory for a " << p_dim << "^3 volume" << std::endl;
+		return false;
+	}
+
+	m_voxels = voxels;
+	m_dim = p_dim;
+	m_bytes = bytes;
+	return true;
+}
+
+bool VolumeMemory::Allocate(int p_dim)
+{
+	if (!Reserve(p_dim)) { return false; }
+
+	// first touch, on all threads
+	Voxel *voxels = m_voxels;
+#pragma omp parallel for schedule(static)
+	for (int z = 0; z < p_dim; ++z) {
+		const size_t sliceVoxels = (size_t)p_dim * p_dim;
+		Voxel *slice = voxels + z * sliceVoxels;
+		for (size_t i = 0; i < sliceVoxels; ++i) {
+			slice[i].rgb[0] = slice[i].rgb[1] = slice[i].rgb[2] = 0;
+			slice[i].isEmpty = true;
+		}
+	}
+	return true;
+}
+
+bool VolumeMemory::MapSparse(int p_dim)
+{
+	CleanUp();
+#ifdef VOLUME_MAPPING_SUPPORTED
+	const size_t bytes = GetVolumeBytes(p_dim);
+	if (bytes == 0) {
+		std::cout << "A " << p_dim << "^3 volume does not fit in the address space" << std::endl;
+		return false;
+	}
+	void *memory = mmap(NULL, bytes, PROT_READ | PROT_WRITE, SparseFlags, -1, 0);
+	if (memory == MAP_FAILED) {
+		std::cout << "Could not map a sparse " << p_dim << "^3 volume" << std::endl;
+		return false;
+	}
+	#ifdef MADV_NOHUGEPAGE
+	madvise(memory, bytes, MADV_NOHUGEPAGE); // a huge page for every voxel written would not fit in memory
+	#endif
+	m_voxels = (Voxel*)memory;
+	m_dim = p_dim;
+	m_bytes = m_mappedBytes = bytes;
+	return true;
+#else
+	std::cout << "Sparse volumes are not supported on this platform" << std::endl;
+	return false;
+#endif
+}
+
+void VolumeMemory::DiscardSparse( void )
+{
+#ifdef VOLUME_MAPPING_SUPPORTED
+	// mapped over with fresh pages, which drops the written ones
+	if (m_mappedBytes > 0 && mmap(m_voxels, m_mappedBytes, PROT_READ | PROT_WRITE, SparseFlags | MAP_FIXED, -1, 0) != MAP_FAILED) {
+	#ifdef MADV_NOHUGEPAGE
+		madvise(m_voxels, m_mappedBytes, MADV_NOHUGEPAGE);
+	#endif
+	}
+#endif
+}
+
+void VolumeMemory::CleanUp( void )
+{
+	if (m_voxels != NULL) {
+#ifdef VOLUME_MAPPING_SUPPORTED
+		if (m_mappedBytes > 0) {
+			munmap(m_voxels, m_mappedBytes);
+		} else
+#endif
+		{
+			::operator delete(m_voxels);
+		}
+	}
+	m_voxels = NULL;
+	m_dim = 0;
+	m_bytes = m_mappedBytes = 0;
+	m_advised = false;
+}
+
+Voxel *VolumeMemory::GetVoxels( void )
+{
+	return m_voxels;
+}
+
+const Voxel *VolumeMemory::GetVoxels( void ) const
+{
+	return m_voxels;
+}
+
+int VolumeMemory::GetDim( void ) const
+{
+	return m_dim;
+}
+
+size_t VolumeMemory::GetBytes( void ) const
+{
+	return m_bytes;
+}
+
+bool VolumeMemory::IsHugePageAdvised( void ) const
+{
+	return m_advised;
+}
+
+size_t VolumeMemory::GetHugePageBytes( void ) const
+{
+	size_t hugeBytes = 0;
+#ifdef __linux__
+	if (m_mappedBytes == 0) { return 0; }
+	FILE *file = fopen("/proc/self/smaps", "r");
+	if (file == NULL) { return 0; }
+	// the kernel may have merged the volume with a neighbouring mapping, what that holds is counted too
+	const unsigned long start = (unsigned long)m_voxels;
+	const unsigned long end = start + m_mappedBytes;
+	bool overlaps = false;
+	char line[512];
+	while (fgets(line, sizeof(line), file) != NULL) {
+		unsigned long from, to;
+		unsigned long kb;
+		if (sscanf(line, "%lx-%lx ", &from, &to) == 2) {
+			overlaps = from < end && to > start;
+		} else if (overlaps && sscanf(line, "AnonHugePages: %lu kB", &kb) == 1) {
+			hugeBytes += (size_t)kb * 1024;
+		}
+	}
+	fclose(file);
+#endif
+	return (hugeBytes < m_bytes) ? hugeBytes : m_bytes;
+}
+
+void VolumeMemory::PrintReport(std::ostream &p_out) const
+{
+	size_t pageSize = 4096;
+#ifdef VOLUME_MAPPING_SUPPORTED
+	pageSize = (size_t)sysconf(_SC_PAGESIZE);
+#endif
+	const size_t hugeBytes = GetHugePageBytes();
+	const size_t entries = (hugeBytes + HugePageSize - 1) / HugePageSize + (m_bytes - hugeBytes + pageSize - 1) / pageSize;
+	const size_t smallEntries = (m_bytes + pageSize - 1) / pageSize;
+	p_out << m_dim << "^3 volume, " << (m_bytes >> 20) << " MB, " << (hugeBytes >> 20) << " MB on " << (HugePageSize >> 20) << " MB pages";
+	p_out << (m_advised ? "" : " (not advised)") << ", " << entries << " TLB entries cover it (" << smallEntries << " with " << (pageSize >> 10) << " KB pages)" << std::endl;
+}
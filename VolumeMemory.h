@@ -0,0 +1,53 @@
+#ifndef VOLUMEMEMORY_H_INCLUDED__
+#define VOLUMEMEMORY_H_INCLUDED__
+
+#include <cstddef>
+#include <ostream>
+#include "Voxel.h"
+
+// Memory for a dense dim^3 volume. Rays jump all over a large volume, so with
+// 4 KB pages nearly every step of a traversal needs a TLB entry of its own.
+// Where mmap is available the volume is mapped on a 2 MB boundary and, on Linux,
+// advised to be backed by transparent huge pages, so that one TLB entry covers
+// 512 times as much of it. The volume is cleared by all OpenMP threads, and
+// since a page is placed on the NUMA node of the thread that first touches it,
+// that spreads the pages over the nodes the render threads run on. Anywhere
+// else it comes from the heap.
+class VolumeMemory
+{
+public:
+	enum { HugePageSize = 2 * 1024 * 1024 };
+private:
+	Voxel	*m_voxels;
+	int		m_dim;
+	size_t	m_bytes;
+	size_t	m_mappedBytes;	// 0 when taken from the heap
+	bool	m_advised;		// huge pages were asked for
+private:
+					VolumeMemory(const VolumeMemory&) {}
+	VolumeMemory	&operator=(const VolumeMemory&) { return *this; }
+public:
+					VolumeMemory( void );
+					~VolumeMemory( void );
+	// an empty p_dim^3 volume, false when it does not fit in memory or the address space
+	bool			Allocate(int p_dim);
+	// like Allocate but leaves the memory untouched, for the caller to fill (and place) as it likes
+	bool			Reserve(int p_dim);
+	// maps a p_dim^3 volume without memory behind it, on small pages; it reads as solid (zero) until written, so
+	// that volumes larger than memory can be checked along a few paths. False where volumes are not mapped
+	bool			MapSparse(int p_dim);
+	// gives back what was written to a sparse volume, which then reads as solid again
+	void			DiscardSparse( void );
+	void			CleanUp( void );
+	Voxel			*GetVoxels( void );
+	const Voxel		*GetVoxels( void ) const;
+	int				GetDim( void ) const;
+	size_t			GetBytes( void ) const;
+	bool			IsHugePageAdvised( void ) const;
+	// bytes of the volume the kernel currently backs with huge pages, from /proc/self/smaps (Linux only)
+	size_t			GetHugePageBytes( void ) const;
+	// size, pages and the TLB entries needed to cover the volume
+	void			PrintReport(std::ostream &p_out) const;
+};
+
+#endif
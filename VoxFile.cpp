@@ -0,0 +1,585 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+
+#include "VoxFile.h"
+#include "Math3d.h"
+
+// Bounds checked little endian reads out of a chunk.
+struct VoxReader
+{
+	const byte_t	*at;
+	const byte_t	*end;
+	bool			ok;
+
+	VoxReader(const byte_t *p_at, const byte_t *p_end) : at(p_at), end(p_end), ok(true) {}
+
+	bool Skip(size_t p_bytes)
+	{
+		if (!ok || (size_t)(end - at) < p_bytes) {
+			ok = false;
+			return false;
+		}
+		at += p_bytes;
+		return true;
+	}
+	int ReadInt( void )
+	{
+		const byte_t *from = at;
+		if (!Skip(4)) { return 0; }
+		return int( Uint32( from[0] ) | (Uint32( from[1] ) << 8) | (Uint32( from[2] ) << 16) | (Uint32( from[3] ) << 24) );
+	}
+	// copies a STRING into p_out (truncated to p_size - 1 characters)
+	void ReadString(char *p_out, int p_size)
+	{
+		const int length = ReadInt();
+		const byte_t *from = at;
+		if (length < 0 || !Skip((size_t)length)) {
+			p_out[0] = '\0';
+			return;
+		}
+		const int copy = Min2(length, p_size - 1);
+		memcpy(p_out, from, (size_t)copy);
+		p_out[copy] = '\0';
+	}
+};
+
+// The attributes of a DICT that the scene graph and the materials use.
+struct VoxAttributes
+{
+	bool	hidden;
+	bool	hasTranslation;
+	int		translation[3];
+	int		rotation;	// packed, -1 if not given
+	bool	seeThrough;		// a glass, blend or media material
+	float	transparency;	// 0 if not given
+
+	void Read(VoxReader &p_reader)
+	{
+		hidden = false;
+		hasTranslation = false;
+		rotation = -1;
+		seeThrough = false;
+		transparency = 0.f;
+		const int count = p_reader.ReadInt();
+		for (int i = 0; i < count && p_reader.ok; ++i) {
+			char key[64], value[64];
+			p_reader.ReadString(key, sizeof(key));
+			p_reader.ReadString(value, sizeof(value));
+			if (strcmp(key, "_hidden") == 0) {
+				hidden = atoi(value) != 0;
+			} else if (strcmp(key, "_t") == 0) {
+				hasTranslation = sscanf(value, "%d %d %d", &translation[0], &translation[1], &translation[2]) == 3;
+			} else if (strcmp(key, "_r") == 0) {
+				rotation = atoi(value);
+			} else if (strcmp(key, "_type") == 0) {
+				seeThrough = strcmp(value, "_glass") == 0 || strcmp(value, "_blend") == 0 || strcmp(value, "_media") == 0;
+			} else if (strcmp(key, "_trans") == 0 || strcmp(key, "_alpha") == 0) {
+				transparency = float( atof(value) );
+			}
+		}
+	}
+};
+
+static const int Identity[3][3] = { {1, 0, 0}, {0, 1, 0}, {0, 0, 1} };
+
+// Rows of the rotation hold one +-1 each: bits 0-1 and 2-3 give its column in the first two rows,
+// the third row takes the column that is left, and bits 4-6 make a row's entry negative.
+static bool UnpackRotation(int p_packed, int p_rotation[3][3])
+{
+	const int column0 = p_packed & 3;
+	const int column1 = (p_packed >> 2) & 3;
+	if (column0 > 2 || column1 > 2 || column0 == column1) { return false; }
+	const int columns[3] = { column0, column1, 3 - column0 - column1 };
+	for (int row = 0; row < 3; ++row) {
+		for (int column = 0; column < 3; ++column) {
+			p_rotation[row][column] = 0;
+		}
+		p_rotation[row][columns[row]] = ((p_packed >> (4 + row)) & 1) ? -1 : 1;
+	}
+	return true;
+}
+
+static void Rotate(const int p_rotation[3][3], const int *p_in, int *p_out)
+{
+	for (int row = 0; row < 3; ++row) {
+		p_out[row] = p_rotation[row][0] * p_in[0] + p_rotation[row][1] * p_in[1] + p_rotation[row][2] * p_in[2];
+	}
+}
+
+static int FloorHalf(int p_value)
+{
+	return (p_value >= 0) ? p_value / 2 : -((1 - p_value) / 2);
+}
+
+// false when two of the entries share a position; p_seen is a bit per position, all clear before and after
+static bool HasUniquePositions(const byte_t *p_entries, int p_count, mtl::Array<Uint32> &p_seen)
+{
+	if (p_seen.GetSize() == 0) { p_seen.Resize((256 * 256 * 256) / 32); }
+	int i = 0;
+	for (; i < p_count; ++i) {
+		const Uint32 key = Uint32( p_entries[4 * i] ) | (Uint32( p_entries[4 * i + 1] ) << 8) | (Uint32( p_entries[4 * i + 2] ) << 16);
+		const Uint32 bit = Uint32( 1 ) << (key & 31);
+		if (p_seen[key >> 5] & bit) { break; }
+		p_seen[key >> 5] |= bit;
+	}
+	const bool unique = (i == p_count);
+	while (--i >= 0) {
+		const Uint32 key = Uint32( p_entries[4 * i] ) | (Uint32( p_entries[4 * i + 1] ) << 8) | (Uint32( p_entries[4 * i + 2] ) << 16);
+		p_seen[key >> 5] &= ~(Uint32( 1 ) << (key & 31));
+	}
+	return unique;
+}
+
+// MagicaVoxel's default palette: a 6x6x6 color cube without black, then ramps of red, green, blue and gray.
+static void GetDefaultPalette(Uint32 *p_palette)
+{
+	static const int steps[6] = { 0xff, 0xcc, 0x99, 0x66, 0x33, 0x00 };
+	static const int ramp[10] = { 0xee, 0xdd, 0xbb, 0xaa, 0x88, 0x77, 0x55, 0x44, 0x22, 0x11 };
+	int index = 0;
+	p_palette[index++] = 0;
+	for (int r = 0; r < 6; ++r) {
+		for (int g = 0; g < 6; ++g) {
+			for (int b = 0; b < 6 && index < 216; ++b) {
+				p_palette[index++] = Uint32( steps[r] ) | (Uint32( steps[g] ) << 8) | (Uint32( steps[b] ) << 16);
+			}
+		}
+	}
+	for (int channel = 0; channel < 3; ++channel) {
+		for (int i = 0; i < 10; ++i) {
+			p_palette[index++] = Uint32( ramp[i] ) << (8 * channel);
+		}
+	}
+	for (int i = 0; i < 10; ++i) {
+		p_palette[index++] = Uint32( ramp[i] ) * 0x010101u;
+	}
+}
+
+VoxScene::VoxScene( void ) : m_voxels(NULL), m_dim(0), m_voxelCount(0), m_translucent(false), m_visits(0)
+{
+	memset(m_paletteOpacity, 255, sizeof(m_paletteOpacity));
+}
+
+VoxScene::~VoxScene( void )
+{
+	CleanUp();
+}
+
+bool VoxScene::Parse(const byte_t *p_data, size_t p_size, Uint32 *p_palette)
+{
+	VoxReader file(p_data, p_data + p_size);
+	if (p_size < 8 || memcmp(p_data, "VOX ", 4) != 0) { return false; }
+	file.Skip(8); // magic and version
+
+	// MAIN holds every other chunk as a child
+	if (!file.Skip(4) || memcmp(file.at - 4, "MAIN", 4) != 0) { return false; }
+	const int mainContent = file.ReadInt();
+	file.ReadInt();
+	if (mainContent < 0 || !file.Skip((size_t)mainContent)) { return false; }
+
+	int pendingSize[3] = { 0, 0, 0 };
+	bool hasSize = false;
+	mtl::Array<Uint32> seen;
+	while (file.ok && file.at < file.end) {
+		const byte_t *id = file.at;
+		file.Skip(4);
+		const int contentBytes = file.ReadInt();
+		const int childBytes = file.ReadInt();
+		const byte_t *content = file.at;
+		if (contentBytes < 0 || childBytes < 0 || !file.Skip((size_t)contentBytes)) { return false; }
+		VoxReader chunk(content, content + contentBytes);
+
+		if (memcmp(id, "SIZE", 4) == 0) {
+			for (int i = 0; i < 3; ++i) {
+				pendingSize[i] = chunk.ReadInt();
+			}
+			hasSize = true;
+		} else if (memcmp(id, "XYZI", 4) == 0) {
+			const int count = chunk.ReadInt();
+			if (!hasSize || count < 0 || (size_t)(chunk.end - chunk.at) / 4 < (size_t)count) { return false; }
+			for (int i = 0; i < 3; ++i) {
+				if (pendingSize[i] <= 0 || pendingSize[i] > MaxDim) { return false; }
+			}
+			// Decode writes a model's voxels on all threads, which is only safe when no two share a position
+			if (!HasUniquePositions(chunk.at, count, seen)) { return false; }
+			Model model;
+			memcpy(model.size, pendingSize, sizeof(pendingSize));
+			model.voxels = chunk.at;
+			model.count = count;
+			m_models.PushBack(model);
+			hasSize = false;
+		} else if (memcmp(id, "RGBA", 4) == 0) {
+			// file color i is palette index i + 1
+			for (int i = 1; i < 256 && chunk.ok; ++i) {
+				p_palette[i] = Uint32( chunk.ReadInt() ) & 0x00ffffff;
+			}
+		} else if (memcmp(id, "nTRN", 4) == 0 || memcmp(id, "nGRP", 4) == 0 || memcmp(id, "nSHP", 4) == 0) {
+			const int nodeId = chunk.ReadInt();
+			if (nodeId < 0 || nodeId >= (1 << 20)) { return false; }
+			while (m_nodes.GetSize() <= nodeId) {
+				Node empty;
+				memset(&empty, 0, sizeof(empty));
+				empty.type = NODE_NONE;
+				m_nodes.PushBack(empty);
+			}
+			Node &node = m_nodes[nodeId];
+			VoxAttributes attributes;
+			attributes.Read(chunk);
+			node.hidden = attributes.hidden;
+			node.layer = -1;
+			memcpy(node.rotation, Identity, sizeof(Identity));
+			node.translation[0] = node.translation[1] = node.translation[2] = 0;
+			node.first = m_links.GetSize();
+			node.count = 0;
+			if (id[1] == 'T') {
+				node.type = NODE_TRANSFORM;
+				m_links.PushBack(chunk.ReadInt());
+				node.count = 1;
+				chunk.ReadInt(); // reserved
+				node.layer = chunk.ReadInt();
+				// only the first animation frame is used
+				if (chunk.ReadInt() > 0) {
+					VoxAttributes frame;
+					frame.Read(chunk);
+					if (frame.hasTranslation) {
+						for (int i = 0; i < 3; ++i) {
+							if (frame.translation[i] < -MaxTranslation || frame.translation[i] > MaxTranslation) { return false; }
+						}
+						memcpy(node.translation, frame.translation, sizeof(node.translation));
+					}
+					if (frame.rotation >= 0 && !UnpackRotation(frame.rotation, node.rotation)) { return false; }
+				}
+			} else if (id[1] == 'G') {
+				node.type = NODE_GROUP;
+				node.count = chunk.ReadInt();
+				for (int i = 0; i < node.count && chunk.ok; ++i) {
+					m_links.PushBack(chunk.ReadInt());
+				}
+			} else {
+				node.type = NODE_SHAPE;
+				node.count = chunk.ReadInt();
+				for (int i = 0; i < node.count && chunk.ok; ++i) {
+					m_links.PushBack(chunk.ReadInt());
+					VoxAttributes modelAttributes;
+					modelAttributes.Read(chunk);
+				}
+			}
+			if (!chunk.ok) { return false; }
+		} else if (memcmp(id, "MATL", 4) == 0) {
+			// material i belongs to palette index i
+			const int material = chunk.ReadInt();
+			VoxAttributes attributes;
+			attributes.Read(chunk);
+			if (material > 0 && material < 256 && attributes.seeThrough && attributes.transparency > 0.f) {
+				const float opacity = 1.f - Min2(attributes.transparency, 1.f);
+				m_paletteOpacity[material] = byte_t( Max2(int( opacity * 255.f + 0.5f ), 1) );
+				m_translucent = m_translucent || m_paletteOpacity[material] < 255;
+			}
+		} else if (memcmp(id, "LAYR", 4) == 0) {
+			const int layer = chunk.ReadInt();
+			VoxAttributes attributes;
+			attributes.Read(chunk);
+			if (attributes.hidden) { m_hiddenLayers.PushBack(layer); }
+		}
+		// other chunks (cameras, notes) do not affect the voxels
+		if (!file.Skip((size_t)childBytes)) { return false; }
+	}
+	return file.ok;
+}
+
+void VoxScene::AddInstance(int p_model, const int p_rotation[3][3], const int p_translation[3])
+{
+	if (p_model < 0 || p_model >= m_models.GetSize()) { return; }
+	const Model &model = m_models[p_model];
+	Instance instance;
+	instance.model = p_model;
+	memcpy(instance.rotation, p_rotation, sizeof(instance.rotation));
+	memcpy(instance.translation, p_translation, sizeof(instance.translation));
+
+	// the bounds follow from the corner voxels
+	for (int i = 0; i < 3; ++i) {
+		instance.min[i] = INT_MAX;
+		instance.max[i] = INT_MIN;
+	}
+	for (int corner = 0; corner < 8; ++corner) {
+		int local[3], scene[3];
+		for (int i = 0; i < 3; ++i) {
+			const int v = ((corner >> i) & 1) ? model.size[i] - 1 : 0;
+			local[i] = 2 * v + 1 - model.size[i];
+		}
+		Rotate(p_rotation, local, scene);
+		for (int i = 0; i < 3; ++i) {
+			const int voxel = FloorHalf(scene[i] + p_translation[i]);
+			instance.min[i] = Min2(instance.min[i], voxel);
+			instance.max[i] = Max2(instance.max[i], voxel);
+		}
+	}
+	m_instances.PushBack(instance);
+}
+
+void VoxScene::Place(int p_node, const int p_rotation[3][3], const int p_translation[3], int p_depth)
+{
+	if (p_node < 0 || p_node >= m_nodes.GetSize() || p_depth > MaxDepth || m_instances.GetSize() >= MaxInstances || ++m_visits > MaxVisits) { return; }
+	const Node &node = m_nodes[p_node];
+	if (node.hidden) { return; }
+	for (int i = 0; i < m_hiddenLayers.GetSize(); ++i) {
+		if (m_hiddenLayers[i] == node.layer) { return; }
+	}
+
+	switch (node.type) {
+	case NODE_TRANSFORM:
+		{
+			// parent * node, translations are doubled like the model coordinates
+			int rotation[3][3], translation[3], doubled[3];
+			for (int row = 0; row < 3; ++row) {
+				for (int column = 0; column < 3; ++column) {
+					rotation[row][column] = p_rotation[row][0] * node.rotation[0][column] + p_rotation[row][1] * node.rotation[1][column] + p_rotation[row][2] * node.rotation[2][column];
+				}
+				doubled[row] = 2 * node.translation[row];
+			}
+			Rotate(p_rotation, doubled, translation);
+			for (int i = 0; i < 3; ++i) {
+				translation[i] += p_translation[i];
+			}
+			Place(m_links[node.first], rotation, translation, p_depth + 1);
+		}
+		break;
+	case NODE_GROUP:
+		for (int i = 0; i < node.count; ++i) {
+			Place(m_links[node.first + i], p_rotation, p_translation, p_depth + 1);
+		}
+		break;
+	case NODE_SHAPE:
+		for (int i = 0; i < node.count; ++i) {
+			AddInstance(m_links[node.first + i], p_rotation, p_translation);
+		}
+		break;
+	default: break;
+	}
+}
+
+Uint32 VoxScene::GetIndex(const Instance &p_instance, const byte_t *p_entry) const
+{
+	if (p_entry[3] == 0) { return InvalidIndex; }
+	const Model &model = m_models[p_instance.model];
+	int local[3], scene[3];
+	for (int axis = 0; axis < 3; ++axis) {
+		local[axis] = 2 * p_entry[axis] + 1 - model.size[axis];
+	}
+	Rotate(p_instance.rotation, local, scene);
+	int v[3];
+	for (int axis = 0; axis < 3; ++axis) {
+		v[axis] = FloorHalf(scene[axis] + p_instance.translation[axis]) + m_offset[axis];
+	}
+	// scene z is up, the volume's up is -y
+	const int dim = m_dim;
+	const int x = v[0];
+	const int y = dim - 1 - v[2];
+	const int z = v[1];
+	if (x < 0 || x >= dim || y < 0 || y >= dim || z < 0 || z >= dim) { return InvalidIndex; }
+	return Uint32( (z * dim + y) * dim + x );
+}
+
+Voxel VoxScene::GetVoxel(const byte_t *p_entry) const
+{
+	const Uint32 color = m_palette[p_entry[3]];
+	Voxel voxel;
+	voxel.rgb[color24::r] = byte_t( color );
+	voxel.rgb[color24::g] = byte_t( color >> 8 );
+	voxel.rgb[color24::b] = byte_t( color >> 16 );
+	voxel.isEmpty = false;
+	return voxel;
+}
+
+void VoxScene::Decode(const Instance &p_instance)
+{
+	const Model &model = m_models[p_instance.model];
+	Voxel *volume = m_voxels;
+	int added = 0;
+
+	// Parse made sure that a model holds every position once, so threads never write the same voxel; voxels
+	// an earlier model wrote are only counted once
+#pragma omp parallel for schedule(static) reduction(+:added)
+	for (int i = 0; i < model.count; ++i) {
+		const byte_t *entry = model.voxels + 4 * i;
+		const Uint32 index = GetIndex(p_instance, entry);
+		if (index != InvalidIndex) {
+			if (volume[index].isEmpty) { ++added; }
+			volume[index] = GetVoxel(entry);
+			if (m_translucent) {
+				m_opacity[index] = m_paletteOpacity[entry[3]];
+			}
+		}
+	}
+	m_voxelCount += added;
+}
+
+void VoxScene::DecodeRange(int p_model, int p_first, int p_count, Uint32 *p_indices, Voxel *p_voxels, byte_t *p_opacity) const
+{
+	const Instance &instance = m_instances[p_model];
+	const byte_t *entries = m_models[instance.model].voxels + 4 * p_first;
+
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < p_count; ++i) {
+		const byte_t *entry = entries + 4 * i;
+		p_indices[i] = GetIndex(instance, entry);
+		if (p_indices[i] != InvalidIndex) {
+			p_voxels[i] = GetVoxel(entry);
+			if (p_opacity != NULL) {
+				p_opacity[i] = m_paletteOpacity[entry[3]];
+			}
+		}
+	}
+}
+
+bool VoxScene::Open(const char *p_file)
+{
+	CleanUp();
+	FILE *file = fopen(p_file, "rb");
+	if (file == NULL) {
+		std::cout << "Could not open " << p_file << std::endl;
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	const long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	bool read = size > 0;
+	if (read) {
+		m_data.Resize((int)size);
+		read = fread(m_data.GetData(), 1, (size_t)size, file) == (size_t)size;
+	}
+	fclose(file);
+
+	GetDefaultPalette(m_palette);
+	if (!read || !Parse(m_data.GetData(), (size_t)size, m_palette) || m_models.GetSize() == 0) {
+		std::cout << "Not a MagicaVoxel file: " << p_file << std::endl;
+		CleanUp();
+		return false;
+	}
+
+	if (m_nodes.GetSize() > 0) {
+		const int origin[3] = { 0, 0, 0 };
+		m_visits = 0;
+		Place(0, Identity, origin, 0);
+	} else {
+		// no scene graph, models start at the origin
+		for (int i = 0; i < m_models.GetSize(); ++i) {
+			AddInstance(i, Identity, m_models[i].size);
+		}
+	}
+	m_nodes.Free();
+	m_links.Free();
+	m_hiddenLayers.Free();
+	if (m_instances.GetSize() == 0) {
+		std::cout << "No visible models in " << p_file << std::endl;
+		CleanUp();
+		return false;
+	}
+
+	// a cube around the scene with a quarter of its size free on every side, so that cameras can orbit it;
+	// dimensions are rounded up to whole bricks, or to a power of two when that is not much larger since the
+	// renderer has traversal kernels for those
+	int min[3], max[3];
+	memcpy(min, m_instances[0].min, sizeof(min));
+	memcpy(max, m_instances[0].max, sizeof(max));
+	for (int i = 1; i < m_instances.GetSize(); ++i) {
+		for (int axis = 0; axis < 3; ++axis) {
+			min[axis] = Min2(min[axis], m_instances[i].min[axis]);
+			max[axis] = Max2(max[axis], m_instances[i].max[axis]);
+		}
+	}
+	const int extent = Max3(max[0] - min[0], max[1] - min[1], max[2] - min[2]) + 1;
+	int dim = (extent + extent / 2 + 7) & ~7;
+	int power = 16;
+	while (power < dim) { power *= 2; }
+	if (power <= dim + dim / 4) { dim = power; }
+	if (dim > MaxDim) {
+		std::cout << "Scene in " << p_file << " is too large (" << extent << " voxels across)" << std::endl;
+		CleanUp();
+		return false;
+	}
+	m_dim = dim;
+	for (int axis = 0; axis < 3; ++axis) {
+		m_offset[axis] = (dim - (max[axis] - min[axis] + 1)) / 2 - min[axis];
+	}
+	return true;
+}
+
+bool VoxScene::Load(const char *p_file)
+{
+	if (!Open(p_file)) { return false; }
+
+	if (!m_memory.Allocate(m_dim)) {
+		CleanUp();
+		return false;
+	}
+	m_voxels = m_memory.GetVoxels();
+	if (m_translucent) {
+		m_opacity.Resize(m_dim * m_dim * m_dim);
+		memset(m_opacity.GetData(), 255, (size_t)m_opacity.GetSize());
+	}
+
+	// later models are drawn over earlier ones where they overlap
+	for (int i = 0; i < m_instances.GetSize(); ++i) {
+		Decode(m_instances[i]);
+	}
+
+	// the models pointed into the file data
+	m_models.Free();
+	m_data.Free();
+	return true;
+}
+
+void VoxScene::CleanUp( void )
+{
+	m_memory.CleanUp();
+	m_voxels = NULL;
+	m_dim = 0;
+	m_voxelCount = 0;
+	m_opacity.Free();
+	memset(m_paletteOpacity, 255, sizeof(m_paletteOpacity));
+	m_translucent = false;
+	m_data.Free();
+	m_models.Free();
+	m_nodes.Free();
+	m_links.Free();
+	m_hiddenLayers.Free();
+	m_instances.Free();
+}
+
+const Voxel *VoxScene::GetVoxels( void ) const
+{
+	return m_voxels;
+}
+
+const byte_t *VoxScene::GetOpacity( void ) const
+{
+	return (m_opacity.GetSize() > 0) ? m_opacity.GetData() : NULL;
+}
+
+bool VoxScene::IsTranslucent( void ) const
+{
+	return m_translucent;
+}
+
+int VoxScene::GetDim( void ) const
+{
+	return m_dim;
+}
+
+int VoxScene::GetModelCount( void ) const
+{
+	return m_instances.GetSize();
+}
+
+int VoxScene::GetModelVoxelCount(int p_model) const
+{
+	return m_models[m_instances[p_model].model].count;
+}
+
+int VoxScene::GetVoxelCount( void ) const
+{
+	return m_voxelCount;
+}
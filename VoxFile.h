@@ -0,0 +1,111 @@
+#ifndef VOXFILE_H_INCLUDED__
+#define VOXFILE_H_INCLUDED__
+
+#include <cstddef>
+#include "mtlArray.h"
+#include "Voxel.h"
+#include "VolumeMemory.h"
+
+// Scene from a MagicaVoxel .vox file, decoded into the dense dim^3 layout that
+// Renderer::Render takes. Every model the scene graph places (nTRN, nGRP, nSHP,
+// translations and rotations) is written straight into the volume, model by
+// model, with the voxels of a model decoded on all threads; models without a
+// scene graph (older files) sit at the origin. Hidden nodes and layers are
+// left out. The palette comes from the file or is MagicaVoxel's default one.
+// Palette entries whose material is glass, blend or media with a transparency
+// give their voxels an opacity below 255, see Renderer::SetOpacity.
+// MagicaVoxel's z axis points up, in the volume it points to -y (up on the
+// screen for an unturned camera). The scene is centered in the volume with an
+// empty border so that cameras can orbit it.
+class VoxScene
+{
+public:
+	enum { MaxDim = 1024 };	// so that volume indices fit the Uint32 of DecodeRange
+	enum { MaxDepth = 64 };	// scene graph nesting that is followed
+	enum { MaxInstances = 65536 };	// models placed, a graph that shares nodes may place many
+	enum { MaxVisits = 1 << 20 };	// scene graph nodes walked
+	enum { MaxTranslation = 1 << 16 };	// so that doubled and summed coordinates stay in range
+	static const Uint32 InvalidIndex = 0xffffffff;
+private:
+	struct Model
+	{
+		int				size[3];
+		const byte_t	*voxels;	// x, y, z and palette index per voxel, in the file
+		int				count;
+	};
+	// a model placed in the scene, in doubled coordinates so that model centers are whole numbers
+	struct Instance
+	{
+		int		model;
+		int		rotation[3][3];
+		int		translation[3];
+		int		min[3], max[3];	// bounds in scene voxels
+	};
+	enum NodeType
+	{
+		NODE_NONE,
+		NODE_TRANSFORM,
+		NODE_GROUP,
+		NODE_SHAPE
+	};
+	struct Node
+	{
+		NodeType	type;
+		bool		hidden;
+		int			layer;
+		int			rotation[3][3];
+		int			translation[3];
+		int			first, count;	// children (or models of a shape) in m_links, a transform's child is first
+	};
+private:
+	VolumeMemory			m_memory;
+	Voxel					*m_voxels;
+	int						m_dim;
+	int						m_voxelCount;
+	int						m_offset[3];	// scene to volume coordinates, before z is turned into -y
+	Uint32					m_palette[256];	// 0x00BBGGRR
+	byte_t					m_paletteOpacity[256];	// 255 is opaque
+	bool					m_translucent;	// some palette entry is not opaque
+	mtl::Array<byte_t>		m_opacity;		// per voxel after Load, only for translucent scenes
+	mtl::Array<byte_t>		m_data;			// the file, while loading
+	mtl::Array<Model>		m_models;		// valid while loading
+	mtl::Array<Node>		m_nodes;		// by node id
+	mtl::Array<int>			m_links;
+	mtl::Array<int>			m_hiddenLayers;
+	mtl::Array<Instance>	m_instances;
+	int						m_visits;
+private:
+				VoxScene(const VoxScene&) {}
+	VoxScene	&operator=(const VoxScene&) { return *this; }
+	bool		Parse(const byte_t *p_data, size_t p_size, Uint32 *p_palette);
+	void		Place(int p_node, const int p_rotation[3][3], const int p_translation[3], int p_depth);
+	void		AddInstance(int p_model, const int p_rotation[3][3], const int p_translation[3]);
+	Uint32		GetIndex(const Instance &p_instance, const byte_t *p_entry) const;
+	Voxel		GetVoxel(const byte_t *p_entry) const;
+	void		Decode(const Instance &p_instance);
+public:
+				VoxScene( void );
+				~VoxScene( void );
+	// reads the file and places its models without decoding any voxels, see DecodeRange
+	bool		Open(const char *p_file);
+	// Open, then decodes every model into a volume of the scene's own, see GetVoxels
+	bool		Load(const char *p_file);
+	// decodes voxels [p_first, p_first + p_count) of placed model p_model (after Open) to volume indices and
+	// voxels, and to opacities unless p_opacity is NULL, on all threads; voxels that fall outside the volume
+	// get InvalidIndex
+	void		DecodeRange(int p_model, int p_first, int p_count, Uint32 *p_indices, Voxel *p_voxels, byte_t *p_opacity) const;
+	void		CleanUp( void );
+	const Voxel	*GetVoxels( void ) const;
+	// per voxel, laid out like the volume, after Load; NULL when every material is opaque
+	const byte_t	*GetOpacity( void ) const;
+	// some material is not opaque, known after Open
+	bool		IsTranslucent( void ) const;
+	int			GetDim( void ) const;
+	// models placed in the scene
+	int			GetModelCount( void ) const;
+	int			GetModelVoxelCount(int p_model) const;
+	// solid voxels in the volume after Load, voxels that models share count once
+	int			GetVoxelCount( void ) const;
+};
+
+#endif
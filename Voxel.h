@@ -1,10 +1,15 @@
 #ifndef VOXEL_H_INCLUDED__
 #define VOXEL_H_INCLUDED__
 
+#include <cstddef>
 #include "PlatformSDL.h"
 
 typedef unsigned char byte_t;
 
+// index of a voxel in a dense dim^3 volume, (z * dim + y) * dim + x; an int only
+// holds the voxels of volumes up to 1290^3
+typedef ptrdiff_t voxel_index_t;
+
 struct color24
 {
 #ifdef __MACOSX__
@@ -44,4 +49,14 @@ struct Voxel
 	bool	isEmpty;
 };
 
+// bytes of a p_dim^3 volume, 0 when p_dim is not positive or the volume does not fit in the address space
+inline size_t GetVolumeBytes(long long p_dim)
+{
+	const size_t limit = ~size_t( 0 ) / sizeof(Voxel);
+	if (p_dim <= 0 || (unsigned long long)p_dim > limit) { return 0; }
+	const size_t dim = (size_t)p_dim;
+	if (dim > limit / dim || dim * dim > limit / dim) { return 0; }
+	return dim * dim * dim * sizeof(Voxel);
+}
+
 #endif
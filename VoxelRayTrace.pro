@@ -4,7 +4,21 @@ CONFIG -= qt
 
 SOURCES += main.cpp \
     Renderer.cpp \
-    Camera.cpp
+    Camera.cpp \
+    FrameWriter.cpp \
+    BrickMap.cpp \
+    FrameSink.cpp \
+    SharedFrameSink.cpp \
+    VolumeFile.cpp \
+    RenderFarm.cpp \
+    FrameArena.cpp \
+    LightVolume.cpp \
+    FrameStats.cpp \
+    VoxFile.cpp \
+    VolumeLoader.cpp \
+    VolumeMemory.cpp \
+    ThreadTopology.cpp \
+    PerfCounters.cpp
 
 HEADERS += \
     Voxel.h \
@@ -14,10 +28,27 @@ HEADERS += \
     Ray.h \
     PlatformSDL.h \
     mtlList.h \
+    mtlArray.h \
+    mtlAllocator.h \
+    mtlTraits.h \
     Matrix.h \
     MathTypes.h \
     Math3d.h \
-    Camera.h
+    Camera.h \
+    FrameWriter.h \
+    BrickMap.h \
+    FrameSink.h \
+    SharedFrameSink.h \
+    VolumeFile.h \
+    RenderFarm.h \
+    FrameArena.h \
+    LightVolume.h \
+    FrameStats.h \
+    VoxFile.h \
+    VolumeLoader.h \
+    VolumeMemory.h \
+    ThreadTopology.h \
+    PerfCounters.h
 
 LIBS += \
 	-lSDL \
@@ -29,3 +60,6 @@ QMAKE_CXXFLAGS += \
 
 QMAKE_LFLAGS += \
 	-fopenmp
+
+# shm_open lives in librt on older glibc
+unix:!macx: LIBS += -lrt
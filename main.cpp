@@ -1,28 +1,231 @@
 #include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
 //#include <omp.h>
 
 #include "PlatformSDL.h"
 #include "Camera.h"
 #include "Renderer.h"
+#include "FrameWriter.h"
+#include "SharedFrameSink.h"
+#include "RenderFarm.h"
+#include "VolumeFile.h"
+#include "LightVolume.h"
+#include "FrameStats.h"
+#include "VolumeLoader.h"
 #include "RobotModel.h"
 #include "Math3d.h"
 
-// Rudimentary OpenMP support is commented out
+// Renderer::Render spreads rows and tiles over OpenMP threads when built with OpenMP
 // see main(...) and Renderer::Render(...)
-// see included header files in main.cpp and Renderer.cpp
 
-int main(int argc, char **argv)
+// Prints how much transient memory the renderer's per thread frame arenas needed.
+void PrintArenaReport(const Renderer &renderer)
 {
-	if (SDL_Init(SDL_INIT_VIDEO) == -1) {
-		std::cout << "Could not init SDL" << std::endl; 
+	size_t highWater = 0;
+	int heapAllocations = 0;
+	for (int i = 0; i < renderer.GetArenaCount(); ++i) {
+		if (renderer.GetArena(i).GetHighWater() > highWater) { highWater = renderer.GetArena(i).GetHighWater(); }
+		heapAllocations += renderer.GetArena(i).GetHeapAllocations();
+	}
+	std::cout << renderer.GetArenaCount() << " frame arenas, high water " << highWater << " bytes, " << heapAllocations << " heap allocations" << std::endl;
+}
+
+// Waits at most p_timeoutMs for an event. SDL 1.2 has no SDL_WaitEventTimeout, this
+// polls the way SDL_WaitEvent does.
+bool WaitEvent(SDL_Event &event, Uint32 timeoutMs)
+{
+	const Uint32 start = SDL_GetTicks();
+	while (!SDL_PollEvent(&event)) {
+		if (SDL_GetTicks() - start >= timeoutMs) { return false; }
+		SDL_Delay(10);
+	}
+	return true;
+}
+
+// Makes the yellow voxels of the volume lamps of level p_level.
+void AddLamps(LightVolume &light, const Voxel *volume, int dim, int level)
+{
+	for (int z = 0; z < dim; ++z) {
+		for (int y = 0; y < dim; ++y) {
+			for (int x = 0; x < dim; ++x) {
+				const Voxel &voxel = volume[(voxel_index_t( z ) * dim + y) * dim + x];
+				if (!voxel.isEmpty && voxel.rgb[color24::r] == 255 && voxel.rgb[color24::g] == 255 && voxel.rgb[color24::b] == 0) {
+					light.SetEmission(x, y, z, level);
+				}
+			}
+		}
+	}
+}
+
+// Renders a frame and presents it, timing both for stats when there are any.
+void RenderFrame(Renderer &renderer, const Camera &camera, const Voxel *volume, int dim, FrameStats *stats, bool overlay)
+{
+	const double start = FrameStats::GetTimeMs();
+	renderer.Render(camera, volume, dim);
+	if (stats != NULL && overlay) {
+		stats->DrawOverlay(renderer.GetFrame(), renderer.GetWidth(), renderer.GetHeight());
+	}
+	renderer.Refresh(); // only blocks when the sink has no room for another frame
+	if (stats != NULL) {
+		stats->AddFrame(float( FrameStats::GetTimeMs() - start ), renderer.IsInstrumented() ? &renderer.GetCounters() : NULL);
+	}
+}
+
+// Renders a turntable around the center of the volume to the renderer's frame sink, or through the farm when there is one.
+void RenderTurntable(Renderer &renderer, RenderFarm *farm, FrameSink &sink, int frames, const Voxel *volume, int dim, FrameStats *stats, bool overlay)
+{
+	// orbit inside the volume, since rays originating outside of it are not supported
+	const vec3_t center(dim * 0.5f, dim * 0.5f, dim * 0.5f);
+	const float radius = dim * 0.4f;
+	const float turn = RAD_MAX / float( frames );
+	Camera camera(sink.GetWidth(), sink.GetHeight());
+	for (int frame = 0; frame < frames; ++frame) {
+		camera.SetPosition(center - camera.GetDirection() * radius);
+		if (farm != NULL) {
+			const double start = FrameStats::GetTimeMs();
+			farm->Render(camera, sink);
+			if (stats != NULL) { stats->AddFrame(float( FrameStats::GetTimeMs() - start ), NULL); }
+		} else {
+			RenderFrame(renderer, camera, volume, dim, stats, overlay);
+		}
+		camera.Turn(turn, 0.f);
+	}
+}
+
+// Renders a turntable to numbered image files without opening a window.
+int RenderOffline(Renderer &renderer, RenderFarm *farm, int w, int h, const char *prefix, int frames, int writers, const Voxel *volume, int dim, FrameStats *stats, bool overlay)
+{
+	FrameWriter writer;
+	if (!writer.Init(prefix, w, h, writers, writers * 2)) {
+		std::cout << "Could not start frame writer" << std::endl;
+		return 1;
+	}
+	if (!renderer.Init(&writer)) {
+		std::cout << "Could not init renderer" << std::endl;
 		return 1;
 	}
 
-	//omp_set_num_threads(omp_get_num_procs);
+	const Uint32 start = SDL_GetTicks();
+	RenderTurntable(renderer, farm, writer, frames, volume, dim, stats, overlay);
+	writer.Flush();
+	const Uint32 time = SDL_GetTicks() - start;
+	PrintArenaReport(renderer);
+	if (stats != NULL) { stats->Print(std::cout); }
+	renderer.CleanUp();
+
+	std::cout << writer.GetWrittenCount() << " frames written to " << prefix << "*.ppm in " << time << " ms" << std::endl;
+	if (writer.GetErrorCount() > 0) {
+		std::cout << writer.GetErrorCount() << " frames could not be written" << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+// Renders a turntable to a shared memory ring for other local processes to read.
+int RenderShared(Renderer &renderer, RenderFarm *farm, int w, int h, const char *name, int frames, const Voxel *volume, int dim, FrameStats *stats, bool overlay)
+{
+	SharedFrameSink ring;
+	if (!ring.Init(name, w, h, 3)) {
+		std::cout << "Could not create shared memory frames " << name << std::endl;
+		return 1;
+	}
+	if (!renderer.Init(&ring)) {
+		std::cout << "Could not init renderer" << std::endl;
+		return 1;
+	}
+
+	const Uint32 start = SDL_GetTicks();
+	RenderTurntable(renderer, farm, ring, frames, volume, dim, stats, overlay);
+	const Uint32 time = SDL_GetTicks() - start;
+	PrintArenaReport(renderer);
+	if (stats != NULL) { stats->Print(std::cout); }
+	renderer.CleanUp();
+
+	std::cout << ring.GetPublishedCount() << " frames published to " << name << " in " << time << " ms" << std::endl;
+	return 0;
+}
+
+// Checks both traversal modes against their reference on random rays, and on the primary rays of the turntable
+// that RenderOffline renders.
+int CheckTraversal(Renderer &renderer, int w, int h, int frames, int rays, const Voxel *volume, int dim)
+{
+	if (!renderer.InitHeadless(w, h)) {
+		std::cout << "Could not init renderer" << std::endl;
+		return 1;
+	}
+	Renderer::TraversalCheck random;
+	random.Clear();
+	Renderer::CheckTraversal(volume, dim, rays, random, std::cout);
+	std::cout << "random rays through the " << dim << "^3 volume: ";
+	random.Print(std::cout);
+
+	Renderer::TraversalCheck turntable;
+	turntable.Clear();
+	const vec3_t center(dim * 0.5f, dim * 0.5f, dim * 0.5f);
+	const float radius = dim * 0.4f;
+	const float turn = RAD_MAX / float( frames );
+	Camera camera(w, h);
+	for (int frame = 0; frame < frames; ++frame) {
+		camera.SetPosition(center - camera.GetDirection() * radius);
+		char view[32];
+		sprintf(view, "frame %d", frame);
+		renderer.CheckTraversal(camera, view, volume, dim, turntable, std::cout);
+		camera.Turn(turn, 0.f);
+	}
+	std::cout << "primary rays of " << frames << " turntable frames: ";
+	turntable.Print(std::cout);
+	renderer.CleanUp();
+	return (random.Agrees() && turntable.Agrees()) ? 0 : 1;
+}
 
+// Checks both traversal modes against their reference on random paths through a solid dim^3 volume that is
+// only backed by memory where the paths were emptied, so that it can be larger than memory.
+int CheckTraversalPaths(int rays, int dim)
+{
+	VolumeMemory memory;
+	if (!memory.MapSparse(dim)) { return 1; }
+	Renderer::TraversalCheck paths;
+	paths.Clear();
+	Renderer::CheckTraversalPaths(memory, rays, paths, std::cout);
+	std::cout << "random paths through a sparse " << dim << "^3 volume: ";
+	paths.Print(std::cout);
+	return paths.Agrees() ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
 	int w = 800;
 	int h = 600;
 	bool fs = false;
+	const char *out = NULL;
+	const char *shm = NULL;
+	int frames = 360;
+	int writers = 2;
+	int aaSamples = 0;
+	Renderer::AntiAliasPattern aaPattern = Renderer::AA_ROTATED_GRID;
+	Renderer::VariableRateMode vrsMode = Renderer::VRS_OFF;
+	Renderer::TraversalMode traversal = Renderer::TRAVERSE_FLOAT;
+	int ddaCheck = 0;
+	int ddaPaths = 0;
+	Renderer::ScreenOrder order = Renderer::ORDER_ROWS;
+	bool skip = false;
+	bool splat = false;
+	int giSamples = 0;
+	float timeBudget = 0.f;
+	int lampLevel = 0;
+	float statsInterval = 0.f;
+	const char *statsFile = NULL;
+	bool overlay = false;
+	bool perf = false;
+	const char *volumeFile = NULL;
+	const char *voxFile = NULL;
+	const char *farmAddress = NULL;
+	int farmWorkers = 0;
+	const char *workerAddress = NULL;
+	Renderer::ThreadPlacement placement = Renderer::PLACE_OFF;
+	bool replicate = false;
 	if (argc > 1 && (argc-1)%2 == 0) {
 		for (int i = 1; i < argc; i+=2) {
 			if (strcmp(argv[i], "-w") == 0) {
@@ -34,13 +237,228 @@ int main(int argc, char **argv)
 			} else if (strcmp(argv[i], "-fs") == 0) {
 				fs = bool( atoi(argv[i+1]) );
 				std::cout << "fullscreen set to " << fs << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-out") == 0) {
+				out = argv[i+1];
+				std::cout << "offline output set to " << out << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-shm") == 0) {
+				shm = argv[i+1];
+				std::cout << "shared memory output set to " << shm << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-volume") == 0) {
+				volumeFile = argv[i+1];
+				std::cout << "volume file set to " << volumeFile << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-vox") == 0) {
+				voxFile = argv[i+1];
+				std::cout << "MagicaVoxel file set to " << voxFile << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-farm") == 0) {
+				farmAddress = argv[i+1];
+				std::cout << "render farm address set to " << farmAddress << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-farmworkers") == 0) {
+				farmWorkers = atoi(argv[i+1]);
+				std::cout << "local farm workers set to " << farmWorkers << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-worker") == 0) {
+				workerAddress = argv[i+1];
+				std::cout << "render farm worker for " << workerAddress << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-frames") == 0) {
+				frames = atoi(argv[i+1]);
+				std::cout << "frame count set to " << frames << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-writers") == 0) {
+				writers = atoi(argv[i+1]);
+				std::cout << "writer threads set to " << writers << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-aa") == 0) {
+				aaSamples = atoi(argv[i+1]);
+				std::cout << "edge antialiasing samples set to " << aaSamples << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-aapattern") == 0) {
+				if (strcmp(argv[i+1], "grid") == 0)			{ aaPattern = Renderer::AA_GRID; }
+				else if (strcmp(argv[i+1], "halton") == 0)	{ aaPattern = Renderer::AA_HALTON; }
+				else										{ aaPattern = Renderer::AA_ROTATED_GRID; }
+				std::cout << "edge antialiasing pattern set to " << aaPattern << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-vrs") == 0) {
+				if (strcmp(argv[i+1], "focus") == 0)		{ vrsMode = Renderer::VRS_FOCUS; }
+				else if (strcmp(argv[i+1], "content") == 0)	{ vrsMode = Renderer::VRS_CONTENT; }
+				else										{ vrsMode = Renderer::VRS_OFF; }
+				std::cout << "variable rate mode set to " << vrsMode << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-dda") == 0) {
+				traversal = (strcmp(argv[i+1], "fixed") == 0) ? Renderer::TRAVERSE_FIXED : Renderer::TRAVERSE_FLOAT;
+				std::cout << "traversal set to " << traversal << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-ddacheck") == 0) {
+				ddaCheck = atoi(argv[i+1]);
+				std::cout << "traversal check rays set to " << ddaCheck << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-ddapaths") == 0) {
+				ddaPaths = atoi(argv[i+1]);
+				std::cout << "traversal check path volume set to " << ddaPaths << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-order") == 0) {
+				if (strcmp(argv[i+1], "morton") == 0)		{ order = Renderer::ORDER_MORTON; }
+				else if (strcmp(argv[i+1], "hilbert") == 0)	{ order = Renderer::ORDER_HILBERT; }
+				else										{ order = Renderer::ORDER_ROWS; }
+				std::cout << "screen order set to " << order << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-skip") == 0) {
+				skip = bool( atoi(argv[i+1]) );
+				std::cout << "temporal empty space skipping set to " << skip << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-splat") == 0) {
+				splat = bool( atoi(argv[i+1]) );
+				std::cout << "brick splatting set to " << splat << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-gi") == 0) {
+				giSamples = atoi(argv[i+1]);
+				std::cout << "global illumination samples set to " << giSamples << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-budget") == 0) {
+				timeBudget = float( atof(argv[i+1]) );
+				std::cout << "frame time budget set to " << timeBudget << " ms from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-light") == 0) {
+				lampLevel = atoi(argv[i+1]);
+				std::cout << "lamp light level set to " << lampLevel << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-pin") == 0) {
+				if (strcmp(argv[i+1], "cores") == 0)		{ placement = Renderer::PLACE_CORES; }
+				else if (strcmp(argv[i+1], "threads") == 0)	{ placement = Renderer::PLACE_THREADS; }
+				else										{ placement = Renderer::PLACE_OFF; }
+				std::cout << "thread placement set to " << placement << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-replicate") == 0) {
+				replicate = bool( atoi(argv[i+1]) );
+				std::cout << "volume replication set to " << replicate << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-stats") == 0) {
+				statsInterval = float( atof(argv[i+1]) );
+				std::cout << "frame statistics interval set to " << statsInterval << " seconds from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-statscsv") == 0) {
+				statsFile = argv[i+1];
+				std::cout << "frame statistics file set to " << statsFile << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-overlay") == 0) {
+				overlay = bool( atoi(argv[i+1]) );
+				std::cout << "frame statistics overlay set to " << overlay << " from argument " << argv[i+1] << std::endl;
+			} else if (strcmp(argv[i], "-perf") == 0) {
+				perf = bool( atoi(argv[i+1]) );
+				std::cout << "hardware performance counters set to " << perf << " from argument " << argv[i+1] << std::endl;
 			} else {
 				std::cout << "Unknown argument: " << argv[i] << std::endl;
 			}
 		}
 	}
 
+	//omp_set_num_threads(omp_get_num_procs);
+
 	Renderer renderer;
+	renderer.SetAntiAliasing(aaSamples, aaPattern);
+	renderer.SetVariableRate(vrsMode);
+	renderer.SetTraversal(traversal);
+	renderer.SetScreenOrder(order);
+	renderer.SetTemporalSkip(skip);
+	renderer.SetSplatting(splat);
+	renderer.SetGlobalIllumination(giSamples);
+	renderer.SetTimeBudget(timeBudget);
+	if (placement != Renderer::PLACE_OFF) {
+		if (renderer.SetThreadPlacement(placement)) {
+			std::cout << "render threads pinned on " << renderer.GetNodeCount() << " NUMA nodes" << std::endl;
+		} else {
+			std::cout << "Thread placement is not supported on this platform" << std::endl;
+		}
+	}
+	renderer.SetVolumeReplication(replicate);
+
+	// frame statistics, and the renderer's counters with them, are only kept when asked for
+	FrameStats frameStats;
+	const bool keepStats = statsInterval > 0.f || statsFile != NULL || overlay || perf;
+	if (statsFile != NULL && !frameStats.OpenCsv(statsFile)) { return 1; }
+	frameStats.SetPrintInterval(statsInterval);
+	renderer.SetInstrumentation(keepStats);
+	if (perf && workerAddress == NULL && !renderer.SetPerfCounters(true)) {
+		std::cout << "Hardware performance counters are not available" << std::endl;
+	}
+	FrameStats *stats = keepStats ? &frameStats : NULL;
+
+	if (workerAddress != NULL) {
+		if (volumeFile == NULL) {
+			std::cout << "Workers need a volume file" << std::endl;
+			return 1;
+		}
+		return RenderFarm::RunWorker(workerAddress, volumeFile, perf);
+	}
+
+	// a volume or scene file loads in the background, the robot is there right away
+	const Voxel *volume = Robot;
+	int dim = RobotDim;
+	LightVolume light;
+	VolumeLoader loader;
+	const char *sceneFile = (volumeFile != NULL) ? volumeFile : voxFile;
+	if (sceneFile != NULL) {
+		if (!loader.Start(sceneFile, (lampLevel > 0) ? &light : NULL)) { return 1; }
+		volume = NULL;
+		dim = 0;
+	} else if (lampLevel > 0 && light.Build(volume, dim)) {
+		AddLamps(light, volume, dim, lampLevel);
+		renderer.SetLightVolume(&light);
+	}
+
+	if (out != NULL || shm != NULL || ddaCheck > 0) {
+		if (SDL_Init(0) == -1) {
+			std::cout << "Could not init SDL" << std::endl;
+			return 1;
+		}
+
+		if (loader.IsStarted()) {
+			const double start = FrameStats::GetTimeMs();
+			if (!loader.Wait()) {
+				SDL_Quit();
+				return 1;
+			}
+			volume = loader.GetVoxels();
+			dim = loader.GetDim();
+			renderer.SetOpacity(loader.GetOpacity());
+			std::cout << sceneFile << " loaded into a " << dim << "^3 volume in " << int( FrameStats::GetTimeMs() - start ) << " ms" << std::endl;
+			loader.GetMemory().PrintReport(std::cout);
+			if (lampLevel > 0 && light.IsBuiltFor(volume, dim)) {
+				AddLamps(light, volume, dim, lampLevel);
+				renderer.SetLightVolume(&light);
+			}
+		}
+
+		if (ddaCheck > 0) {
+			const int result = (ddaPaths > 0) ? CheckTraversalPaths(ddaCheck, ddaPaths) : CheckTraversal(renderer, w, h, frames, ddaCheck, volume, dim);
+			loader.CleanUp();
+			SDL_Quit();
+			return result;
+		}
+
+		RenderFarm farm;
+		char tempVolume[1024] = "";
+		if (farmAddress != NULL) {
+			if (volumeFile == NULL) {
+				if (!SaveTempVolume(tempVolume, sizeof(tempVolume), volume, dim)) {
+					std::cout << "Could not write a volume file for the workers" << std::endl;
+					SDL_Quit();
+					return 1;
+				}
+				volumeFile = tempVolume;
+				std::cout << "volume written to " << volumeFile << " for the workers" << std::endl;
+			}
+			RenderFarm::Settings settings;
+			settings.traversal = traversal;
+			settings.splatting = splat;
+			settings.perfCounters = perf;
+			if (!farm.Init(farmAddress, w, h, volume, dim, settings)) {
+				if (tempVolume[0] != '\0') { remove(tempVolume); }
+				SDL_Quit();
+				return 1;
+			}
+			farm.SpawnLocalWorkers(farmWorkers, volumeFile);
+			std::cout << farm.WaitForWorkers(farmWorkers, 10000) << " farm workers connected" << std::endl;
+		}
+
+		RenderFarm *farmPtr = (farmAddress != NULL) ? &farm : NULL;
+		const int result = (out != NULL) ? RenderOffline(renderer, farmPtr, w, h, out, frames, writers, volume, dim, stats, overlay) : RenderShared(renderer, farmPtr, w, h, shm, frames, volume, dim, stats, overlay);
+		if (farmPtr != NULL) {
+			std::cout << farm.GetReassignedCount() << " farm tiles reassigned, " << farm.GetLocalTileCount() << " traced by the coordinator" << std::endl;
+			farm.CleanUp();
+		}
+		// the workers are gone, and with them the last use of the volume file
+		if (tempVolume[0] != '\0') { remove(tempVolume); }
+		loader.CleanUp();
+		SDL_Quit();
+		return result;
+	}
+
+	if (SDL_Init(SDL_INIT_VIDEO) == -1) {
+		std::cout << "Could not init SDL" << std::endl; 
+		return 1;
+	}
+
 	if (!renderer.Init(w, h, fs)) {
 		std::cout << "Could not init video mode" << std::endl;
 		SDL_Quit();
@@ -54,7 +472,11 @@ int main(int argc, char **argv)
 
 	SDL_Event event;
 	Camera camera(w, h);
-	camera.SetPosition(vec3_t(8.f, 8.f, 8.f));
+	camera.SetPosition(vec3_t(dim * 0.5f, dim * 0.5f, dim * 0.5f));
+	bool loading = loader.IsStarted();
+	// every publish changes the volume, so until it is complete the threads read it where it is loaded
+	renderer.SetVolumeReplication(replicate && !loading);
+	int loadedPercent = -1;
 	bool quit = false;
 	float left = 0.f;
 	float right = 0.f;
@@ -62,8 +484,14 @@ int main(int argc, char **argv)
 	float backward = 0.f;
 	float up = 0.f;
 	float down = 0.f;
+	const Uint32 idleWaitMs = 100;
+	const Uint32 loadingWaitMs = 10;
+	const Uint32 publishBudgetMs = 4;
 	while (!quit) {
-		while (SDL_PollEvent(&event)) {
+		// nothing moves and the last frame is still on screen, sleep until something happens
+		const bool moving = forward != 0.f || backward != 0.f || left != 0.f || right != 0.f || up != 0.f || down != 0.f;
+		bool hasEvent = (!moving && (dim == 0 || renderer.IsFrameCurrent(camera, volume, dim))) ? WaitEvent(event, loading ? loadingWaitMs : idleWaitMs) : SDL_PollEvent(&event);
+		for (; hasEvent; hasEvent = SDL_PollEvent(&event)) {
 			switch (event.type) {
 			case SDL_KEYDOWN:
 				switch (event.key.keysym.sym) {
@@ -85,6 +513,15 @@ int main(int argc, char **argv)
 				case SDLK_e:
 					up = -1.f;
 					break;
+				case SDLK_F1:
+					// shows the frame statistics, which are kept from then on
+					overlay = !overlay;
+					if (stats == NULL) {
+						stats = &frameStats;
+						renderer.SetInstrumentation(true);
+					}
+					renderer.InvalidateFrame();
+					break;
 				case SDLK_ESCAPE:
 					quit = true;
 					break;
@@ -120,24 +557,70 @@ int main(int argc, char **argv)
 			case SDL_MOUSEMOTION:
 				camera.Turn(-event.motion.xrel * 0.01f, 0.f);
 				break;
+			case SDL_VIDEORESIZE:
+				if (!renderer.Init(event.resize.w, event.resize.h, fs)) {
+					std::cout << "Could not resize video mode" << std::endl;
+					quit = true;
+				}
+				camera.SetPortVectors(event.resize.w, event.resize.h);
+				break;
+			case SDL_VIDEOEXPOSE:
+				renderer.InvalidateFrame();
+				break;
 			default: break;
 			}
 		}
 
+		// what was loaded since the last frame goes into the volume between frames
+		if (loading) {
+			if (loader.Publish(publishBudgetMs)) { renderer.InvalidateVolume(); }
+			if (dim == 0 && loader.GetDim() > 0) {
+				volume = loader.GetVoxels();
+				dim = loader.GetDim();
+				renderer.SetOpacity(loader.GetOpacity());
+				camera.SetPosition(vec3_t(dim * 0.5f, dim * 0.5f, dim * 0.5f));
+			}
+			const int percent = int( loader.GetProgress() * 100.f );
+			if (loader.HasFailed()) {
+				std::cout << "Could not load " << sceneFile << std::endl;
+				loading = false;
+				quit = true;
+			} else if (loader.IsDone()) {
+				renderer.SetVolumeReplication(replicate);
+				if (lampLevel > 0 && light.IsBuiltFor(volume, dim)) {
+					AddLamps(light, volume, dim, lampLevel);
+					renderer.SetLightVolume(&light);
+				}
+				loader.GetMemory().PrintReport(std::cout);
+				SDL_WM_SetCaption("Voxel Ray Tracing", NULL);
+				loading = false;
+			} else if (percent != loadedPercent) {
+				char caption[64];
+				sprintf(caption, "Voxel Ray Tracing - loading %d%%", percent);
+				SDL_WM_SetCaption(caption, NULL);
+				loadedPercent = percent;
+			}
+		}
+
 		const vec3_t prevCam = camera.GetPosition();
 		camera.Move(forward + backward, left + right, down + up);
 		for (int i = 0; i < 3; ++i) {
-			if (camera.GetPosition()[i] < 0 || camera.GetPosition()[i] >= 16) {
+			if (camera.GetPosition()[i] < 0 || camera.GetPosition()[i] >= dim) {
 				camera.SetPosition(prevCam);
 				break;
 			}
 		}
 
-		renderer.Render(camera, Robot, RobotDim);
-		renderer.Refresh();
+		if (!quit && dim > 0 && !renderer.IsFrameCurrent(camera, volume, dim)) {
+			RenderFrame(renderer, camera, volume, dim, stats, overlay);
+		}
 	}
 
+	if (stats != NULL) { stats->Print(std::cout); }
+
+	const bool failed = loader.HasFailed();
 	renderer.CleanUp();
+	loader.CleanUp();
 	SDL_Quit();
-	return 0;
+	return failed ? 1 : 0;
 }
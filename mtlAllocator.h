@@ -0,0 +1,162 @@
+#ifndef MTL_ALLOCATOR_H_INCLUDED__
+#define MTL_ALLOCATOR_H_INCLUDED__
+
+#include <cstddef>
+#include <new>
+
+namespace mtl
+{
+
+	// Allocator policies hand out raw, uninitialized storage for one object of type
+	// obj_t at a time. Each container owns its own allocator instance.
+	//
+	// void	*Allocate( void )			storage for one object
+	// void	Release(void *p_obj)		return storage for one object
+	// bool	ReleaseAll( void )			return every allocation at once, false if not supported
+	// Transferable						true if storage may be released by another instance
+
+	//
+	// HeapAllocator
+	//
+	template < typename obj_t >
+	class HeapAllocator
+	{
+	public:
+		enum { Transferable = true };
+	private:
+						HeapAllocator(const mtl::HeapAllocator<obj_t>&) {}
+		mtl::HeapAllocator<obj_t>	&operator=(const mtl::HeapAllocator<obj_t>&) { return *this; }
+	public:
+		inline			HeapAllocator( void ) {}
+		inline void		*Allocate( void ) { return ::operator new(sizeof(obj_t)); }
+		inline void		Release(void *p_obj) { ::operator delete(p_obj); }
+		inline bool		ReleaseAll( void ) { return false; }
+	};
+
+	//
+	// PoolAllocator
+	//
+	// Carves objects out of cache line aligned slabs that grow geometrically. Released
+	// objects go on a free list and are reused first. ReleaseAll rewinds to the first slab
+	// in O(1) without returning memory to the heap, so a container that is filled and
+	// emptied every frame stops allocating after the first few frames.
+	//
+	template < typename obj_t >
+	class PoolAllocator
+	{
+	public:
+		enum { Transferable = false };
+		enum { CacheLine = 64, MinSlabCount = 16, MaxSlabCount = 1024 };
+	private:
+		struct Slab
+		{
+			Slab	*next;
+			char	*objects;
+			int		capacity;
+		};
+		struct FreeObj
+		{
+			FreeObj	*next;
+		};
+	private:
+		Slab	*m_slabs;
+		Slab	*m_current;
+		int		m_used;		// objects handed out from m_current
+		FreeObj	*m_free;
+	private:
+						PoolAllocator(const mtl::PoolAllocator<obj_t>&) {}
+		mtl::PoolAllocator<obj_t>	&operator=(const mtl::PoolAllocator<obj_t>&) { return *this; }
+		static int		GetStride( void );
+		Slab			*NewSlab(int p_capacity);
+	public:
+		inline			PoolAllocator( void );
+		inline			~PoolAllocator( void );
+		void			*Allocate( void );
+		inline void		Release(void *p_obj);
+		inline bool		ReleaseAll( void );
+	};
+
+}
+
+template < typename obj_t >
+int mtl::PoolAllocator<obj_t>::GetStride( void )
+{
+	// small objects are padded to a power of two so that none of them straddle a cache line
+	int stride = sizeof(obj_t) > sizeof(FreeObj) ? (int)sizeof(obj_t) : (int)sizeof(FreeObj);
+	if (stride <= CacheLine) {
+		int pow2 = sizeof(void*);
+		while (pow2 < stride) { pow2 <<= 1; }
+		return pow2;
+	}
+	return (stride + CacheLine - 1) & ~(CacheLine - 1);
+}
+
+template < typename obj_t >
+typename mtl::PoolAllocator<obj_t>::Slab *mtl::PoolAllocator<obj_t>::NewSlab(int p_capacity)
+{
+	char *raw = (char*)::operator new(sizeof(Slab) + CacheLine - 1 + p_capacity * GetStride());
+	Slab *slab = (Slab*)raw;
+	const size_t address = (size_t)(raw + sizeof(Slab));
+	slab->objects = raw + sizeof(Slab) + ((CacheLine - (address & (CacheLine - 1))) & (CacheLine - 1));
+	slab->capacity = p_capacity;
+	slab->next = 0;
+	return slab;
+}
+
+template < typename obj_t >
+mtl::PoolAllocator<obj_t>::PoolAllocator( void ) :
+m_slabs(0), m_current(0), m_used(0), m_free(0)
+{}
+
+template < typename obj_t >
+mtl::PoolAllocator<obj_t>::~PoolAllocator( void )
+{
+	while (m_slabs != 0) {
+		Slab *next = m_slabs->next;
+		::operator delete(m_slabs);
+		m_slabs = next;
+	}
+}
+
+template < typename obj_t >
+void *mtl::PoolAllocator<obj_t>::Allocate( void )
+{
+	if (m_free != 0) {
+		FreeObj *obj = m_free;
+		m_free = obj->next;
+		return obj;
+	}
+	if (m_current == 0 || m_used == m_current->capacity) {
+		if (m_current != 0 && m_current->next != 0) {
+			m_current = m_current->next; // reuse a slab kept by ReleaseAll
+		} else {
+			int capacity = (m_current != 0) ? m_current->capacity * 2 : (int)MinSlabCount;
+			if (capacity > MaxSlabCount) { capacity = MaxSlabCount; }
+			Slab *slab = NewSlab(capacity);
+			if (m_current != 0)	{ m_current->next = slab; }
+			else				{ m_slabs = slab; }
+			m_current = slab;
+		}
+		m_used = 0;
+	}
+	return m_current->objects + (m_used++) * GetStride();
+}
+
+template < typename obj_t >
+void mtl::PoolAllocator<obj_t>::Release(void *p_obj)
+{
+	FreeObj *obj = (FreeObj*)p_obj;
+	obj->next = m_free;
+	m_free = obj;
+}
+
+template < typename obj_t >
+bool mtl::PoolAllocator<obj_t>::ReleaseAll( void )
+{
+	m_free = 0;
+	m_current = m_slabs;
+	m_used = 0;
+	return true;
+}
+
+#endif
@@ -0,0 +1,384 @@
+#ifndef MTL_ARRAY_H_INCLUDED__
+#define MTL_ARRAY_H_INCLUDED__
+
+#include <cstring>
+#include <new>
+#if __cplusplus >= 201103L
+#include <utility>
+#endif
+#include "mtlTraits.h"
+
+namespace mtl
+{
+
+	// in-place storage for the first local_n elements of an Array
+	template < typename type_t, int local_n >
+	class ArrayStorage
+	{
+	private:
+		union
+		{
+			char		bytes[sizeof(type_t) * local_n];
+			long double	alignLongDouble;
+			long long	alignLongLong;
+			void		*alignPointer;
+		} m_storage;
+	public:
+		inline type_t	*GetLocal( void ) { return (type_t*)m_storage.bytes; }
+		inline bool		IsLocal(const type_t *p_data) const { return p_data == (const type_t*)m_storage.bytes; }
+	};
+
+	template < typename type_t >
+	class ArrayStorage<type_t, 0>
+	{
+	public:
+		inline type_t	*GetLocal( void ) { return 0; }
+		inline bool		IsLocal(const type_t*) const { return false; }
+	};
+
+	// Contiguous, growable array. The first local_n elements are stored inside the
+	// array itself; storage moves to the heap once the array outgrows them. Capacity
+	// doubles on growth and is kept by Clear, so arrays reused every frame settle at a
+	// fixed size. Trivially copyable types are relocated with memcpy.
+	template < typename type_t, int local_n = 0 >
+	class Array : private mtl::ArrayStorage<type_t, local_n>
+	{
+	private:
+		type_t	*m_data;
+		int		m_size;
+		int		m_capacity;
+	private:
+		void			Relocate(type_t *p_dst, type_t *p_src, int p_num);
+		inline int		GetGrownCapacity(int p_minCapacity) const;
+		void			Grow(int p_minCapacity);
+		inline void		ReleaseStorage( void );
+	public:
+		inline					Array( void );
+		explicit				Array(int p_size);
+								Array(const mtl::Array<type_t, local_n> &p_array);
+		inline					~Array( void );
+		mtl::Array<type_t, local_n>	&operator=(const mtl::Array<type_t, local_n> &p_array);
+#if __cplusplus >= 201103L
+								Array(mtl::Array<type_t, local_n> &&p_array);
+		mtl::Array<type_t, local_n>	&operator=(mtl::Array<type_t, local_n> &&p_array);
+		void					PushBack(type_t &&p_value);
+		template < typename... args_t >
+		type_t					&Emplace(args_t&&... p_args);
+#else
+		type_t					&Emplace( void );
+#endif
+		void					PushBack(const type_t &p_value);
+		inline void				PopBack( void );
+		void					Remove(int p_index);
+		void					RemoveSwap(int p_index);
+		void					Reserve(int p_capacity);
+		void					Resize(int p_size);
+		void					Clear( void );
+		void					Free( void );
+		inline int				GetSize( void ) const;
+		inline int				GetCapacity( void ) const;
+		inline bool				IsEmpty( void ) const;
+		inline type_t			*GetData( void );
+		inline const type_t		*GetData( void ) const;
+		inline type_t			&GetBack( void );
+		inline const type_t		&GetBack( void ) const;
+		inline type_t			&operator[](int p_index);
+		inline const type_t		&operator[](int p_index) const;
+	};
+
+}
+
+template < typename type_t, int local_n >
+void mtl::Array<type_t, local_n>::Relocate(type_t *p_dst, type_t *p_src, int p_num)
+{
+	if (mtl::IsTriviallyCopyable<type_t>::Value) {
+		if (p_num > 0) { memcpy((void*)p_dst, (const void*)p_src, sizeof(type_t) * p_num); }
+	} else {
+		for (int i = 0; i < p_num; ++i) {
+#if __cplusplus >= 201103L
+			new (p_dst + i) type_t(std::move(p_src[i]));
+#else
+			new (p_dst + i) type_t(p_src[i]);
+#endif
+			p_src[i].~type_t();
+		}
+	}
+}
+
+template < typename type_t, int local_n >
+int mtl::Array<type_t, local_n>::GetGrownCapacity(int p_minCapacity) const
+{
+	const int capacity = m_capacity > 0 ? m_capacity * 2 : 4;
+	return (capacity < p_minCapacity) ? p_minCapacity : capacity;
+}
+
+template < typename type_t, int local_n >
+void mtl::Array<type_t, local_n>::Grow(int p_minCapacity)
+{
+	Reserve(GetGrownCapacity(p_minCapacity));
+}
+
+template < typename type_t, int local_n >
+void mtl::Array<type_t, local_n>::ReleaseStorage( void )
+{
+	if (!this->IsLocal(m_data)) { ::operator delete((void*)m_data); }
+}
+
+template < typename type_t, int local_n >
+mtl::Array<type_t, local_n>::Array( void ) :
+m_data(this->GetLocal()), m_size(0), m_capacity(local_n)
+{}
+
+template < typename type_t, int local_n >
+mtl::Array<type_t, local_n>::Array(int p_size) :
+m_data(this->GetLocal()), m_size(0), m_capacity(local_n)
+{
+	Resize(p_size);
+}
+
+template < typename type_t, int local_n >
+mtl::Array<type_t, local_n>::Array(const mtl::Array<type_t, local_n> &p_array) :
+m_data(this->GetLocal()), m_size(0), m_capacity(local_n)
+{
+	*this = p_array;
+}
+
+template < typename type_t, int local_n >
+mtl::Array<type_t, local_n>::~Array( void )
+{
+	Free();
+}
+
+template < typename type_t, int local_n >
+mtl::Array<type_t, local_n> &mtl::Array<type_t, local_n>::operator=(const mtl::Array<type_t, local_n> &p_array)
+{
+	if (this != &p_array) {
+		Clear();
+		Reserve(p_array.m_size);
+		if (mtl::IsTriviallyCopyable<type_t>::Value) {
+			if (p_array.m_size > 0) { memcpy((void*)m_data, (const void*)p_array.m_data, sizeof(type_t) * p_array.m_size); }
+		} else {
+			for (int i = 0; i < p_array.m_size; ++i) {
+				new (m_data + i) type_t(p_array.m_data[i]);
+			}
+		}
+		m_size = p_array.m_size;
+	}
+	return *this;
+}
+
+#if __cplusplus >= 201103L
+template < typename type_t, int local_n >
+mtl::Array<type_t, local_n>::Array(mtl::Array<type_t, local_n> &&p_array) :
+m_data(this->GetLocal()), m_size(0), m_capacity(local_n)
+{
+	*this = std::move(p_array);
+}
+
+template < typename type_t, int local_n >
+mtl::Array<type_t, local_n> &mtl::Array<type_t, local_n>::operator=(mtl::Array<type_t, local_n> &&p_array)
+{
+	if (this != &p_array) {
+		Free();
+		if (p_array.IsLocal(p_array.m_data)) {
+			// in-place elements can not be stolen, move them one by one
+			Relocate(m_data, p_array.m_data, p_array.m_size);
+			m_size = p_array.m_size;
+			p_array.m_size = 0;
+		} else {
+			m_data = p_array.m_data;
+			m_size = p_array.m_size;
+			m_capacity = p_array.m_capacity;
+			p_array.m_data = p_array.GetLocal();
+			p_array.m_size = 0;
+			p_array.m_capacity = local_n;
+		}
+	}
+	return *this;
+}
+
+template < typename type_t, int local_n >
+void mtl::Array<type_t, local_n>::PushBack(type_t &&p_value)
+{
+	if (m_size == m_capacity) {
+		// p_value may live in this array, so construct the copy before the old storage goes away
+		type_t value(std::move(p_value));
+		Grow(m_size + 1);
+		new (m_data + m_size) type_t(std::move(value));
+	} else {
+		new (m_data + m_size) type_t(std::move(p_value));
+	}
+	++m_size;
+}
+
+template < typename type_t, int local_n >
+template < typename... args_t >
+type_t &mtl::Array<type_t, local_n>::Emplace(args_t&&... p_args)
+{
+	type_t *value;
+	if (m_size == m_capacity) {
+		// the arguments may refer to elements of this array, so construct into the new storage before the old one goes away
+		const int capacity = GetGrownCapacity(m_size + 1);
+		type_t *data = (type_t*)::operator new(sizeof(type_t) * capacity);
+		value = new (data + m_size) type_t(std::forward<args_t>(p_args)...);
+		Relocate(data, m_data, m_size);
+		ReleaseStorage();
+		m_data = data;
+		m_capacity = capacity;
+	} else {
+		value = new (m_data + m_size) type_t(std::forward<args_t>(p_args)...);
+	}
+	++m_size;
+	return *value;
+}
+#else
+template < typename type_t, int local_n >
+type_t &mtl::Array<type_t, local_n>::Emplace( void )
+{
+	if (m_size == m_capacity) { Grow(m_size + 1); }
+	type_t *value = new (m_data + m_size) type_t();
+	++m_size;
+	return *value;
+}
+#endif
+
+template < typename type_t, int local_n >
+void mtl::Array<type_t, local_n>::PushBack(const type_t &p_value)
+{
+	if (m_size == m_capacity) {
+		// p_value may live in this array, so copy it before the old storage goes away
+		type_t value(p_value);
+		Grow(m_size + 1);
+		new (m_data + m_size) type_t(value);
+	} else {
+		new (m_data + m_size) type_t(p_value);
+	}
+	++m_size;
+}
+
+template < typename type_t, int local_n >
+void mtl::Array<type_t, local_n>::PopBack( void )
+{
+	m_data[--m_size].~type_t();
+}
+
+template < typename type_t, int local_n >
+void mtl::Array<type_t, local_n>::Remove(int p_index)
+{
+	for (int i = p_index + 1; i < m_size; ++i) {
+		m_data[i - 1] = m_data[i];
+	}
+	PopBack();
+}
+
+template < typename type_t, int local_n >
+void mtl::Array<type_t, local_n>::RemoveSwap(int p_index)
+{
+	if (p_index != m_size - 1) {
+		m_data[p_index] = m_data[m_size - 1];
+	}
+	PopBack();
+}
+
+template < typename type_t, int local_n >
+void mtl::Array<type_t, local_n>::Reserve(int p_capacity)
+{
+	if (p_capacity > m_capacity) {
+		type_t *data = (type_t*)::operator new(sizeof(type_t) * p_capacity);
+		Relocate(data, m_data, m_size);
+		ReleaseStorage();
+		m_data = data;
+		m_capacity = p_capacity;
+	}
+}
+
+template < typename type_t, int local_n >
+void mtl::Array<type_t, local_n>::Resize(int p_size)
+{
+	if (p_size > m_capacity) { Grow(p_size); }
+	for (int i = m_size; i < p_size; ++i) {
+		new (m_data + i) type_t();
+	}
+	if (!mtl::IsTriviallyDestructible<type_t>::Value) {
+		for (int i = p_size; i < m_size; ++i) {
+			m_data[i].~type_t();
+		}
+	}
+	m_size = p_size;
+}
+
+template < typename type_t, int local_n >
+void mtl::Array<type_t, local_n>::Clear( void )
+{
+	if (!mtl::IsTriviallyDestructible<type_t>::Value) {
+		for (int i = 0; i < m_size; ++i) {
+			m_data[i].~type_t();
+		}
+	}
+	m_size = 0;
+}
+
+template < typename type_t, int local_n >
+void mtl::Array<type_t, local_n>::Free( void )
+{
+	Clear();
+	ReleaseStorage();
+	m_data = this->GetLocal();
+	m_capacity = local_n;
+}
+
+template < typename type_t, int local_n >
+int mtl::Array<type_t, local_n>::GetSize( void ) const
+{
+	return m_size;
+}
+
+template < typename type_t, int local_n >
+int mtl::Array<type_t, local_n>::GetCapacity( void ) const
+{
+	return m_capacity;
+}
+
+template < typename type_t, int local_n >
+bool mtl::Array<type_t, local_n>::IsEmpty( void ) const
+{
+	return m_size == 0;
+}
+
+template < typename type_t, int local_n >
+type_t *mtl::Array<type_t, local_n>::GetData( void )
+{
+	return m_data;
+}
+
+template < typename type_t, int local_n >
+const type_t *mtl::Array<type_t, local_n>::GetData( void ) const
+{
+	return m_data;
+}
+
+template < typename type_t, int local_n >
+type_t &mtl::Array<type_t, local_n>::GetBack( void )
+{
+	return m_data[m_size - 1];
+}
+
+template < typename type_t, int local_n >
+const type_t &mtl::Array<type_t, local_n>::GetBack( void ) const
+{
+	return m_data[m_size - 1];
+}
+
+template < typename type_t, int local_n >
+type_t &mtl::Array<type_t, local_n>::operator[](int p_index)
+{
+	return m_data[p_index];
+}
+
+template < typename type_t, int local_n >
+const type_t &mtl::Array<type_t, local_n>::operator[](int p_index) const
+{
+	return m_data[p_index];
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef MTL_TRAITS_H_INCLUDED__
+#define MTL_TRAITS_H_INCLUDED__
+
+#if __cplusplus >= 201103L
+#include <type_traits>
+#endif
+
+namespace mtl
+{
+
+	// Value is true when objects of type_t can be discarded without running their destructor.
+	template < typename type_t >
+	struct IsTriviallyDestructible
+	{
+#if __cplusplus >= 201103L
+		enum { Value = std::is_trivially_destructible<type_t>::value };
+#elif defined(__GNUC__) || defined(_MSC_VER)
+		enum { Value = __has_trivial_destructor(type_t) };
+#else
+		enum { Value = false };
+#endif
+	};
+
+	// Value is true when objects of type_t can be relocated with memcpy.
+	template < typename type_t >
+	struct IsTriviallyCopyable
+	{
+#if __cplusplus >= 201103L
+		enum { Value = std::is_trivially_copyable<type_t>::value };
+#elif defined(__GNUC__) || defined(_MSC_VER)
+		enum { Value = __has_trivial_copy(type_t) && __has_trivial_destructor(type_t) };
+#else
+		enum { Value = false };
+#endif
+	};
+
+}
+
+#endif